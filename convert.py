@@ -33,6 +33,7 @@ words = (strip_non_alpha(word) for word in text.split())
 words = (word for word in words if len(word) > 0)
 words = (word for word in words if re.fullmatch(r"[ILVX]+", word) is None)
 words = (word.lower() for word in words)
+words = (word for word in words if len(word.encode('utf-8')) <= 64)
 words = (''.join(pad_with_zeros(word)) for word in words)
 text = ''.join(words)
 
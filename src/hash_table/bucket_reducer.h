@@ -0,0 +1,128 @@
+/**
+ * @file bucket_reducer.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ * 
+ * @brief Reduction of 64-bit hash to bucket index without division
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HASH_TABLE_BUCKET_REDUCER_H
+#define __HASH_TABLE_BUCKET_REDUCER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum HashTableReducer
+{
+    /** Remainder of folded 32-bit hash, computed with precomputed magic
+     * number (Lemire's fastmod). Suitable for any bucket count */
+    HASH_TABLE_REDUCER_FASTMOD,
+    /** High half of product of hash and bucket count. Suitable for any
+     * bucket count, but uses only high bits of hash */
+    HASH_TABLE_REDUCER_MULTIPLY_SHIFT,
+    /** High bits of hash multiplied by 2^64 / golden ratio. Suitable for
+     * power-of-two bucket counts only */
+    HASH_TABLE_REDUCER_FIBONACCI
+};
+
+struct BucketReducer
+{
+    HashTableReducer kind;
+    uint32_t size;
+    uint32_t shift;
+    uint64_t magic;
+};
+
+/**
+ * @brief Largest bucket count supported by reducers
+ */
+static const size_t bucket_reducer_max_size = UINT32_MAX;
+
+/**
+ * @brief Get reducer, which is best suited for given bucket count
+ */
+__always_inline
+static HashTableReducer bucket_reducer_default_kind(size_t size)
+{
+    /* Multiplication by golden ratio mixes weak low bits of hash into
+     * high ones, so power-of-two sizes do not need prime modulus */
+    if (size >= 2 && (size & (size - 1)) == 0)
+        return HASH_TABLE_REDUCER_FIBONACCI;
+
+    return HASH_TABLE_REDUCER_FASTMOD;
+}
+
+/**
+ * @brief Precompute constants for reducing hashes to `size` buckets
+ *
+ * @param[out] reducer	- Initialized reducer
+ * @param[in]  size	- Number of buckets
+ * @param[in]  kind	- Reduction method
+ *
+ * @return 0 upon success, -1 if `size` is not supported by `kind`
+ */
+__always_inline
+static int bucket_reducer_init(BucketReducer* reducer, size_t size,
+                               HashTableReducer kind)
+{
+    if (size == 0 || size > bucket_reducer_max_size)
+        return -1;
+
+    reducer->kind  = kind;
+    reducer->size  = (uint32_t) size;
+    reducer->shift = 0;
+    reducer->magic = 0;
+
+    switch (kind)
+    {
+    case HASH_TABLE_REDUCER_FASTMOD:
+        /* ceil(2^64 / size), wraps to 0 for size 1 */
+        reducer->magic = UINT64_MAX / size + 1;
+        return 0;
+
+    case HASH_TABLE_REDUCER_MULTIPLY_SHIFT:
+        return 0;
+
+    case HASH_TABLE_REDUCER_FIBONACCI:
+        if (size < 2 || (size & (size - 1)) != 0)
+            return -1;
+        reducer->shift = (uint32_t) (64 - __builtin_ctzll(size));
+        return 0;
+
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Get index of bucket for given hash
+ */
+__always_inline
+static size_t bucket_reducer_apply(const BucketReducer* reducer,
+                                   uint64_t hash)
+{
+    const uint64_t golden_ratio = 0x9E3779B97F4A7C15;
+
+    switch (reducer->kind)
+    {
+    case HASH_TABLE_REDUCER_FASTMOD:
+    {
+        const uint32_t folded = (uint32_t) (hash ^ (hash >> 32));
+        const uint64_t lowbits = reducer->magic * folded;
+        return (size_t) (((__uint128_t) lowbits * reducer->size) >> 64);
+    }
+    case HASH_TABLE_REDUCER_MULTIPLY_SHIFT:
+        return (size_t) (((__uint128_t) hash * reducer->size) >> 64);
+
+    case HASH_TABLE_REDUCER_FIBONACCI:
+        return (hash * golden_ratio) >> reducer->shift;
+
+    default:
+        return 0;
+    }
+}
+
+#endif /* bucket_reducer.h */
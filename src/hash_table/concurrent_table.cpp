@@ -0,0 +1,455 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "hashes/hash_policy.h"
+
+#include "concurrent_table.h"
+#include "key_kernels.h"
+
+/* Segment grows when it is filled more than half, so that probes of
+ * absent keys stay short */
+static const size_t segment_max_load_divisor = 2;
+
+static const size_t segment_min_capacity = 64;
+
+/* Number of keys, which are hashed together */
+static const size_t batch_chunk_size = 64;
+
+static ConcurrentSlots* allocate_slots(size_t capacity);
+static ConcurrentEntry* find_entry(const ConcurrentSlots* slots,
+                                   const char* key, uint64_t key_hash);
+static int insert_entry(ConcurrentSegment* segment,
+                        const char* key, uint64_t key_hash);
+static int grow_segment(ConcurrentSegment* segment);
+static ConcurrentEntry* allocate_entry(ConcurrentSegment* segment);
+
+__always_inline
+static ConcurrentSegment* get_segment(const ConcurrentHashTable* table,
+                                      uint64_t key_hash)
+{
+    const size_t shift = 64 - __builtin_ctzll(concurrent_table_segment_count);
+    return const_cast<ConcurrentSegment*>(
+                &table->segments[key_hash >> shift]);
+}
+
+__always_inline
+static size_t round_to_pow2(size_t x)
+{
+    size_t result = 1;
+    while (result < x)
+        result <<= 1;
+    return result;
+}
+
+int concurrent_table_ctor(ConcurrentHashTable* table,
+                          size_t expected_distinct)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    memset(table, 0, sizeof(*table));
+
+    size_t capacity = round_to_pow2(expected_distinct
+                                    / concurrent_table_segment_count
+                                    * segment_max_load_divisor);
+    if (capacity < segment_min_capacity)
+        capacity = segment_min_capacity;
+
+    for (size_t i = 0; i < concurrent_table_segment_count; ++i)
+    {
+        ConcurrentSegment* segment = &table->segments[i];
+
+        segment->slots = allocate_slots(capacity);
+        if (!segment->slots ||
+            pthread_mutex_init(&segment->lock, NULL) != 0)
+        {
+            // TODO: Logs
+            free(segment->slots);
+            segment->slots = NULL;
+            concurrent_table_dtor(table);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int concurrent_table_dtor(ConcurrentHashTable* table)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < concurrent_table_segment_count; ++i)
+    {
+        ConcurrentSegment* segment = &table->segments[i];
+
+        /* Segments after failed one were never initialized */
+        if (!segment->slots)
+            break;
+
+        pthread_mutex_destroy(&segment->lock);
+
+        free(segment->slots);
+        while (segment->retired)
+        {
+            ConcurrentSlots* next = segment->retired->retired_next;
+            free(segment->retired);
+            segment->retired = next;
+        }
+
+        for (size_t j = 0; j < segment->slab_count; ++j)
+            free(segment->slabs[j]);
+        free(segment->slabs);
+    }
+
+    memset(table, 0, sizeof(*table));
+
+    return 0;
+}
+
+/**
+ * @brief Increment counter of key with precomputed hash. Present keys are
+ * found without locking, absent keys are inserted under segment lock
+ */
+static int increment_counter(ConcurrentHashTable* table,
+                             const char* key, uint64_t key_hash)
+{
+    ConcurrentSegment* segment = get_segment(table, key_hash);
+
+    const ConcurrentSlots* slots = __atomic_load_n(&segment->slots,
+                                                   __ATOMIC_ACQUIRE);
+    ConcurrentEntry* entry = find_entry(slots, key, key_hash);
+
+    if (entry)
+    {
+        __atomic_fetch_add(&entry->count, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    pthread_mutex_lock(&segment->lock);
+    const int result = insert_entry(segment, key, key_hash);
+    pthread_mutex_unlock(&segment->lock);
+
+    return result;
+}
+
+int concurrent_table_key_increment_counter(ConcurrentHashTable* table,
+                                           const char* key)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(key   != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return increment_counter(table, key, TableHashPolicy::hash(key));
+}
+
+int concurrent_table_key_increment_counter_batch(ConcurrentHashTable* table,
+                                                 const char* const* keys,
+                                                 size_t key_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(keys  != NULL || key_count == 0);
+        for (size_t i = 0; i < key_count; ++i)
+            ASSERT_TRUE(keys[i] != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    uint64_t hashes[batch_chunk_size] = {};
+
+    for (size_t start = 0; start < key_count; start += batch_chunk_size)
+    {
+        const size_t chunk = key_count - start < batch_chunk_size
+                                ? key_count - start
+                                : batch_chunk_size;
+
+        TableHashPolicy::hash_batch(keys + start, chunk, hashes);
+
+        for (size_t i = 0; i < chunk; ++i)
+            if (increment_counter(table, keys[start + i], hashes[i]) < 0)
+                return -1;
+    }
+
+    return 0;
+}
+
+size_t concurrent_table_get_key_count(const ConcurrentHashTable* table,
+                                      const char* key)
+{
+    if (!table || !key)
+        return 0;
+
+    const uint64_t key_hash = TableHashPolicy::hash(key);
+    const ConcurrentSegment* segment = get_segment(table, key_hash);
+
+    const ConcurrentSlots* slots = __atomic_load_n(&segment->slots,
+                                                   __ATOMIC_ACQUIRE);
+    const ConcurrentEntry* entry = find_entry(slots, key, key_hash);
+
+    return entry ? __atomic_load_n(&entry->count, __ATOMIC_RELAXED) : 0;
+}
+
+size_t concurrent_table_get_distinct_count(const ConcurrentHashTable* table)
+{
+    if (!table)
+        return 0;
+
+    size_t distinct_count = 0;
+    for (size_t i = 0; i < concurrent_table_segment_count; ++i)
+        distinct_count += table->segments[i].distinct_count;
+
+    return distinct_count;
+}
+
+int concurrent_table_export(const ConcurrentHashTable* table,
+                            HashTable* target)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table  != NULL);
+        ASSERT_TRUE(target != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    /* Reservation failures are not fatal: table grows instead */
+    hash_table_reserve(target, target->distinct_count +
+                               concurrent_table_get_distinct_count(table));
+
+    for (size_t i = 0; i < concurrent_table_segment_count; ++i)
+    {
+        const ConcurrentSlots* slots = table->segments[i].slots;
+
+        for (size_t j = 0; j <= slots->mask; ++j)
+        {
+            const ConcurrentEntry* entry = slots->entries[j];
+            if (!entry)
+                continue;
+
+            if (hash_table_key_increase_counter_n(target, entry->key,
+                                                  strnlen(entry->key,
+                                                          max_word_length),
+                                                  entry->count) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate empty slot array together with its header
+ *
+ * @return Allocated array, NULL upon error
+ */
+static ConcurrentSlots* allocate_slots(size_t capacity)
+{
+    ConcurrentSlots* slots = (ConcurrentSlots*) calloc(1,
+                                sizeof(*slots)
+                                + capacity * sizeof(*slots->entries));
+    if (!slots)
+        return NULL;
+
+    slots->mask = capacity - 1;
+    slots->entries = (ConcurrentEntry**) (slots + 1);
+
+    return slots;
+}
+
+/**
+ * @brief Find entry of key in slot array. Slots are read atomically, as
+ * they may be filled by concurrent insertion
+ *
+ * @return Found entry, NULL if key is not present
+ */
+template <class Kernels>
+static ConcurrentEntry* find_entry_impl(const ConcurrentSlots* slots,
+                                        const char* key, uint64_t key_hash)
+{
+    size_t index = key_hash & slots->mask;
+
+    while (1)
+    {
+        ConcurrentEntry* entry = __atomic_load_n(&slots->entries[index],
+                                                 __ATOMIC_ACQUIRE);
+        if (!entry)
+            return NULL;
+
+        if (entry->hash == key_hash && Kernels::keys_equal(entry->key, key))
+            return entry;
+
+        index = (index + 1) & slots->mask;
+    }
+}
+
+KEY_KERNELS_DISPATCH(ConcurrentEntry*, find_entry,
+                     (const ConcurrentSlots* slots,
+                      const char* key, uint64_t key_hash),
+                     (slots, key, key_hash))
+
+/**
+ * @brief Insert key into locked segment or increment its counter, if it
+ * was inserted after lock-free lookup
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int insert_entry(ConcurrentSegment* segment,
+                        const char* key, uint64_t key_hash)
+{
+    ConcurrentEntry* entry = find_entry(segment->slots, key, key_hash);
+    if (entry)
+    {
+        __atomic_fetch_add(&entry->count, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if ((segment->distinct_count + 1) * segment_max_load_divisor
+            > segment->slots->mask + 1 &&
+        grow_segment(segment) < 0)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    entry = allocate_entry(segment);
+    if (!entry)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(entry->key, key, sizeof(entry->key));
+    entry->hash = key_hash;
+    entry->count = 1;
+
+    ConcurrentSlots* slots = segment->slots;
+    size_t index = key_hash & slots->mask;
+    while (slots->entries[index])
+        index = (index + 1) & slots->mask;
+
+    /* Entry is filled before it becomes visible to lock-free readers */
+    __atomic_store_n(&slots->entries[index], entry, __ATOMIC_RELEASE);
+    ++ segment->distinct_count;
+
+    return 0;
+}
+
+/**
+ * @brief Move entries of locked segment to slot array of twice the size.
+ * Readers, which loaded old array, keep using it, and either find present
+ * keys there or retry under lock
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int grow_segment(ConcurrentSegment* segment)
+{
+    ConcurrentSlots* old_slots = segment->slots;
+    ConcurrentSlots* new_slots = allocate_slots(2 * (old_slots->mask + 1));
+    if (!new_slots)
+        return -1;
+
+    for (size_t i = 0; i <= old_slots->mask; ++i)
+    {
+        ConcurrentEntry* entry = old_slots->entries[i];
+        if (!entry)
+            continue;
+
+        size_t index = entry->hash & new_slots->mask;
+        while (new_slots->entries[index])
+            index = (index + 1) & new_slots->mask;
+        new_slots->entries[index] = entry;
+    }
+
+    __atomic_store_n(&segment->slots, new_slots, __ATOMIC_RELEASE);
+
+    old_slots->retired_next = segment->retired;
+    segment->retired = old_slots;
+
+    return 0;
+}
+
+/**
+ * @brief Take next unused entry of locked segment, allocating new slab if
+ * needed
+ *
+ * @return Allocated entry, NULL upon error
+ */
+static ConcurrentEntry* allocate_entry(ConcurrentSegment* segment)
+{
+    const size_t index = segment->distinct_count;
+    const size_t slab  = index / concurrent_table_slab_size;
+
+    if (slab == segment->slab_count)
+    {
+        if (segment->slab_count == segment->slab_array_size)
+        {
+            const size_t new_size = segment->slab_array_size
+                                    ? 2 * segment->slab_array_size
+                                    : 4;
+            ConcurrentEntry** slabs = (ConcurrentEntry**) realloc(
+                                            segment->slabs,
+                                            new_size * sizeof(*slabs));
+            if (!slabs)
+                return NULL;
+
+            segment->slabs = slabs;
+            segment->slab_array_size = new_size;
+        }
+
+        ConcurrentEntry* entries = (ConcurrentEntry*) aligned_alloc(
+                                    alignof(ConcurrentEntry),
+                                    concurrent_table_slab_size
+                                    * sizeof(ConcurrentEntry));
+        if (!entries)
+            return NULL;
+
+        segment->slabs[segment->slab_count++] = entries;
+    }
+
+    return &segment->slabs[slab][index % concurrent_table_slab_size];
+}
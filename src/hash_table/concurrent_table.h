@@ -0,0 +1,173 @@
+/**
+ * @file concurrent_table.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Word-count table shared by several writer threads
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HASH_TABLE_CONCURRENT_TABLE_H
+#define __HASH_TABLE_CONCURRENT_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "hash_table.h"
+
+/* Number of independently locked parts of table. Power of two */
+static constexpr size_t concurrent_table_segment_count = 64;
+static_assert((concurrent_table_segment_count &
+               (concurrent_table_segment_count - 1)) == 0,
+              "Segment count must be a power of two");
+
+static constexpr size_t concurrent_table_slab_size = 512;
+
+/*
+ * Entries are never moved, removed or freed until table is destroyed, so
+ * pointer to entry, found without lock, stays valid
+ */
+struct ConcurrentEntry
+{
+    char key[max_word_length] __attribute__((aligned (max_word_length)));
+    uint64_t hash;
+    size_t count;
+};
+
+/*
+ * Open-addressing array of entry pointers. Mask and pointers are
+ * allocated together, so readers always see matching pair
+ */
+struct ConcurrentSlots
+{
+    size_t mask;
+    ConcurrentSlots* retired_next;
+    ConcurrentEntry** entries;
+};
+
+/*
+ * Segment is a separate table with its own lock. Insertions and growth
+ * lock the segment, while increments of present keys only read `slots`
+ * and update counter atomically.
+ *
+ * Growing segment publishes new slot array and keeps the old one in
+ * `retired` list until table is destroyed, because lock-free readers may
+ * still be walking it.
+ */
+struct ConcurrentSegment
+{
+    pthread_mutex_t lock;
+
+    ConcurrentSlots* slots;
+    ConcurrentSlots* retired;
+
+    ConcurrentEntry** slabs;
+    size_t slab_count;
+    size_t slab_array_size;
+
+    size_t distinct_count;
+} __attribute__((aligned (64)));
+
+/*
+ * Key hash selects segment by its highest bits and slot by its lowest
+ * bits
+ */
+struct ConcurrentHashTable
+{
+    ConcurrentSegment segments[concurrent_table_segment_count];
+};
+
+/**
+ * @brief Create and initialize new concurrent table
+ *
+ * @param[out] table		    - Table instance to be initialized
+ * @param[in]  expected_distinct    - Expected number of distinct keys
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL
+ * @exception ENOMEM    - failed to allocate memory for table
+ */
+int concurrent_table_ctor(ConcurrentHashTable* table,
+                          size_t expected_distinct);
+
+/**
+ * @brief Destroy concurrent table. Must not be called concurrently with
+ * any other operation
+ *
+ * @param[inout] table	- Table to be deinitialized
+ *
+ * @return 0 upon success, -1 upon invalid parameter
+ */
+int concurrent_table_dtor(ConcurrentHashTable* table);
+
+/**
+ * @brief Increment counter on entry associated with given key. May be
+ * called by several threads at once
+ *
+ * @param[in] key	- Counted key, padded with zeros to
+ *                        `max_word_length` bytes and aligned
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or key is NULL
+ * @exception ENOMEM    - failed to allocate memory for entry
+ */
+int concurrent_table_key_increment_counter(ConcurrentHashTable* table,
+                                           const char* key);
+
+/**
+ * @brief Increment counters on entries associated with each of given keys.
+ * May be called by several threads at once
+ *
+ * @param[in] keys	    - Array of padded and aligned keys
+ * @param[in] key_count	    - Number of keys in array
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table, keys or one of keys is NULL
+ * @exception ENOMEM    - failed to allocate memory for entry
+ */
+int concurrent_table_key_increment_counter_batch(ConcurrentHashTable* table,
+                                                 const char* const* keys,
+                                                 size_t key_count);
+
+/**
+ * @brief Get value of counter on entry associated with given key. May be
+ * called concurrently with increments, which are then either fully counted
+ * or not counted at all
+ *
+ * @param[in] key	- Padded and aligned key
+ *
+ * @return Counter value
+ */
+size_t concurrent_table_get_key_count(const ConcurrentHashTable* table,
+                                      const char* key);
+
+/**
+ * @brief Get number of distinct keys in table. Must not be called
+ * concurrently with increments
+ *
+ * @return Number of distinct keys
+ */
+size_t concurrent_table_get_distinct_count(const ConcurrentHashTable* table);
+
+/**
+ * @brief Add counts of all keys to regular hash table. Must not be called
+ * concurrently with increments
+ *
+ * @param[in]    table	    - Source table
+ * @param[inout] target	    - Table to add counts to
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or target is NULL
+ * @exception ENOMEM    - failed to allocate memory for entry in target
+ */
+int concurrent_table_export(const ConcurrentHashTable* table,
+                            HashTable* target);
+
+#endif /* concurrent_table.h */
@@ -1,28 +1,80 @@
+#ifndef HASH_TABLE_SWISS
+
 #include <stdlib.h>
 #include <string.h>
-#include <immintrin.h>
 #include <stdint.h>
+#include <immintrin.h>
 
 #include "meerkat_assert/asserts.h"
 
-// #include "hashes/hash_functions.h"
+#include "hashes/hash_policy.h"
 // #include "hashes/asm_hash.h"
 
 #include "hash_table.h"
+#include "key_kernels.h"
 
-static HashTableEntry* find_parent_node(const HashTable* table,
-                                        const char* key, uint64_t key_hash);
-static void mark_free(HashTableEntry* entries, size_t entry_count);
-static int try_grow(HashTable* table);
+/* Number of keys resolved by one pass of batch operations */
+static const size_t batch_chunk_size = 64;
 
-__always_inline
-static size_t round_to_pow2(size_t x)
+/* Number of independent lookups kept in flight by batch operations */
+static const size_t batch_probe_count = 16;
+
+/* Keys are routed by length to hashing and comparison code specialized
+ * for the smallest of these widths, which holds the whole key */
+static constexpr size_t short_key_width  = hash_table_inline_key_size;
+static constexpr size_t medium_key_width = 2*short_key_width;
+static constexpr size_t long_key_width   = max_word_length;
+
+/**
+ * @brief Position of suspended lookup in its key chain
+ */
+enum HashTableProbeStage
 {
-    size_t result = 1;
-    while (result < x)
-        result <<= 1;
-    return result;
-}
+    PROBE_DONE,
+    PROBE_BUCKET,
+    PROBE_CHAIN
+};
+
+/**
+ * @brief State of lookup, which is suspended after issuing prefetch
+ * of next memory location it needs
+ */
+struct HashTableProbe
+{
+    HashTableProbeStage stage;
+    uint32_t entry;
+    size_t key_index;
+};
+
+static uint32_t* find_entry_link(const HashTable* table,
+                                 HashTableBucket* bucket,
+                                 const char* key, uint32_t key_length,
+                                 uint64_t key_hash);
+static int try_grow(HashTable* table);
+static int allocate_slab(HashTable* table);
+static int store_key(HashTable* table, uint32_t index,
+                     const char* key, uint32_t key_length);
+static int reserve_arena_blocks(HashTableArena* arena, size_t block_count);
+static void link_entry_concurrent(HashTable* table, uint32_t index);
+
+static int increment_counter(HashTable* table, const char* key,
+                             uint32_t key_length, uint64_t key_hash,
+                             size_t amount);
+static int decrement_counter(HashTable* table,
+                             const char* key, uint32_t key_length);
+static size_t find_count(const HashTable* table,
+                         const char* key, uint32_t key_length);
+static void find_entries(const HashTable* table,
+                         const char* const* keys, size_t key_count,
+                         uint32_t* lengths, uint64_t* hashes,
+                         uint32_t* entries);
+
+static HashTableBucket* allocate_buckets(size_t bucket_count);
+static void move_last_entry(HashTable* table, uint32_t index);
+static void try_start_rehash(HashTable* table);
+static int start_rehash(HashTable* table, size_t bucket_count);
+static void rehash_step(HashTable* table);
+static void finish_rehash(HashTable* table);
 
 __always_inline
 static int is_prime(size_t x)
@@ -35,52 +87,171 @@ static int is_prime(size_t x)
     return 1;
 }
 
-inline uint64_t __attribute__((always_inline)) hash_murmur(const char* str)
-{
-    /*
-     * MurmurHash64A by Austin Appleby
-     * 64-bit hash for 64-bit platforms
-     *
-     * See https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.cpp
-     */
-
-    const uint64_t mult = 0xC6A4A7935BD1E995;   // This is from the original
-                                                // algorithm
-    const uint64_t seed = 0x8B72E9FB7FAA60FD;   // This is offline-generated
-                                                // seed
-    const size_t    len   = 64;
-    const uint64_t* data = (const uint64_t *)str;
-
-    uint64_t hash = seed ^ (len * mult);
-    uint64_t cur_sym = 0;
-
-    #define PROCESS_CHARS(offset) \
-    "        mov    %[cur_sym],     [%[data] + " #offset "]\n"\
-    "        imul   %[cur_sym],     %[mult]\n"\
-    "        mov    rsi,            %[cur_sym]\n"\
-    "        shr    rsi,            47\n"\
-    "        xor    %[cur_sym],     rsi\n"\
-    "        imul   %[cur_sym],     %[mult]\n"\
-    "        xor    %[hash],        %[cur_sym]\n"\
-    "        imul   %[hash],        %[mult]\n"
-    
-    asm inline(
-        ".intel_syntax noprefix\n"
-        PROCESS_CHARS(0)
-        PROCESS_CHARS(8)
-        PROCESS_CHARS(16)
-        PROCESS_CHARS(24)
-        PROCESS_CHARS(32)
-        PROCESS_CHARS(40)
-        PROCESS_CHARS(48)
-        PROCESS_CHARS(56)
-        ".att_syntax prefix\n"
-        : [cur_sym] "=&r"(cur_sym), [hash] "+r"(hash)
-        : [mult] "r"(mult), [data]"r"(data)
-        : "cc", "rsi");
-    #undef PROCESS_CHARS
-    
-    return hash;
+__always_inline
+static HashTableSlab* get_slab(const HashTable* table, uint32_t index)
+{
+    return table->slabs[index / hash_table_slab_size];
+}
+
+__always_inline
+static HashTableKey* get_key_slot(const HashTable* table, uint32_t index)
+{
+    return &get_slab(table, index)->keys[index % hash_table_slab_size];
+}
+
+__always_inline
+static HashTableLink* get_link(const HashTable* table, uint32_t index)
+{
+    return &get_slab(table, index)->links[index % hash_table_slab_size];
+}
+
+__always_inline
+static char* get_arena_key(const HashTable* table, uint64_t offset)
+{
+    return table->arena.blocks[offset / hash_table_arena_block_size]
+                            + offset % hash_table_arena_block_size;
+}
+
+/**
+ * @brief Get zero-terminated key of entry with given link
+ */
+__always_inline
+static const char* get_key(const HashTable* table, uint32_t index,
+                           const HashTableLink* link)
+{
+    HashTableKey* slot = get_key_slot(table, index);
+
+    return link->length < hash_table_inline_key_size
+                ? slot->data
+                : get_arena_key(table, slot->offset);
+}
+
+/**
+ * @brief Get length of key, padded with zeros to `max_word_length` bytes
+ */
+template <class Kernels>
+__always_inline
+static uint32_t get_key_length_impl(const char* key)
+{
+    const uint64_t zeros = Kernels::bytes_match((const uint8_t*) key, 0);
+
+    return zeros ? (uint32_t) __builtin_ctzll(zeros)
+                 : (uint32_t) max_word_length;
+}
+
+KEY_KERNELS_DISPATCH(uint32_t, get_key_length,
+                     (const char* key),
+                     (key))
+
+/**
+ * @brief Get width of code path specialized for keys of given length
+ */
+__always_inline
+static size_t get_key_width(uint32_t key_length)
+{
+    if (key_length <= short_key_width)  return short_key_width;
+    if (key_length <= medium_key_width) return medium_key_width;
+    return long_key_width;
+}
+
+/**
+ * @brief Hash padded key, reading only bytes within its width
+ */
+__always_inline
+static uint64_t hash_key(const char* key, uint32_t key_length)
+{
+    switch (get_key_width(key_length))
+    {
+    case short_key_width:
+        return TableHashPolicy::hash_prefix<short_key_width>(key);
+    case medium_key_width:
+        return TableHashPolicy::hash_prefix<medium_key_width>(key);
+    default:
+        return TableHashPolicy::hash_prefix<long_key_width>(key);
+    }
+}
+
+/**
+ * @brief Compare first `KeyWidth` bytes of two keys. Comparison is fully
+ * unrolled, so short keys take a single vector comparison
+ */
+template <size_t KeyWidth>
+__always_inline
+static int key_prefixes_equal(const char* lhs, const char* rhs)
+{
+    __m128i cmp = _mm_set1_epi8(-1);
+
+    for (size_t i = 0; i < KeyWidth; i += sizeof(__m128i))
+        cmp = _mm_and_si128(cmp, _mm_cmpeq_epi8(
+                            _mm_load_si128((const __m128i*) (lhs + i)),
+                            _mm_load_si128((const __m128i*) (rhs + i))));
+
+    return _mm_movemask_epi8(cmp) == 0xFFFF;
+}
+
+/**
+ * @brief Compare padded key with key of entry
+ */
+__always_inline
+static int key_matches(const HashTable* table, uint32_t index,
+                       const HashTableLink* link,
+                       const char* key, uint32_t key_length)
+{
+    if (link->length != key_length)
+        return 0;
+
+    const char* stored = get_key(table, index, link);
+
+    switch (get_key_width(key_length))
+    {
+    case short_key_width:
+        return key_prefixes_equal<short_key_width>(key, stored);
+    case medium_key_width:
+        return key_prefixes_equal<medium_key_width>(key, stored);
+    default:
+        return key_prefixes_equal<long_key_width>(key, stored);
+    }
+}
+
+__always_inline
+static size_t* get_count(const HashTable* table, uint32_t index)
+{
+    return &get_slab(table, index)->counts[index % hash_table_slab_size];
+}
+
+__always_inline
+static size_t next_prime(size_t x)
+{
+    while (!is_prime(x))
+        ++ x;
+    return x;
+}
+
+/**
+ * @brief Get bucket holding entries with given hash. During rehash it is
+ * either an old bucket, which was not moved yet, or a new one
+ */
+__always_inline
+static HashTableBucket* get_bucket(const HashTable* table, uint64_t key_hash)
+{
+    if (table->old_buckets)
+    {
+        const size_t old_index = bucket_reducer_apply(&table->old_reducer,
+                                                      key_hash);
+        if (old_index >= table->rehash_index)
+            return &table->old_buckets[old_index];
+    }
+
+    return &table->buckets[bucket_reducer_apply(&table->reducer, key_hash)];
+}
+
+__always_inline
+static void set_iterator_entry(HashTableIterator* it, size_t index)
+{
+    it->index = index;
+    it->key = get_key(it->table, (uint32_t) index,
+                      get_link(it->table, (uint32_t) index));
+    it->count = *get_count(it->table, (uint32_t) index);
 }
 
 int hash_table_ctor(HashTable* table, const size_t bucket_count)
@@ -88,7 +259,9 @@ int hash_table_ctor(HashTable* table, const size_t bucket_count)
     SAFE_BLOCK_START
     {
         ASSERT_TRUE(table != NULL);
-        ASSERT_TRUE(is_prime(bucket_count));
+        ASSERT_ZERO(
+            bucket_reducer_init(&table->reducer, bucket_count,
+                                bucket_reducer_default_kind(bucket_count)));
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -98,15 +271,13 @@ int hash_table_ctor(HashTable* table, const size_t bucket_count)
     }
     SAFE_BLOCK_END
 
-    size_t capacity = round_to_pow2(2*bucket_count);
-    HashTableEntry* buffer = NULL;
+    HashTableBucket* buckets = NULL;
 
     SAFE_BLOCK_START
     {
-        ASSERT_ZERO(
-            posix_memalign((void**)&buffer,
-                            max_word_length, sizeof(*buffer)*capacity));
-        memset(buffer, 0, sizeof(*buffer)*capacity);
+        ASSERT_SIMPLE(
+            buckets = allocate_buckets(bucket_count),
+            action_result != NULL);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -116,14 +287,38 @@ int hash_table_ctor(HashTable* table, const size_t bucket_count)
     }
     SAFE_BLOCK_END
 
-    mark_free(buffer + bucket_count, capacity - bucket_count);
-
-    table->buckets = buffer;
+    table->buckets = buckets;
     table->bucket_count = bucket_count;
-    table->free = buffer + bucket_count;
 
-    table->capacity = capacity;
+    table->old_buckets = NULL;
+    table->old_bucket_count = 0;
+    table->old_reducer = table->reducer;
+    table->rehash_index = 0;
+
+    table->max_load_factor = hash_table_default_load_factor;
+
+    table->slabs = NULL;
+    table->slab_count = 0;
+    table->slab_array_size = 0;
+    table->arena = {};
+    table->capacity = 0;
     table->distinct_count = 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+            try_grow(table));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        free(buckets);
+        free(table->slabs);
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
     table->total_count = 0;
 
     return 0;
@@ -144,29 +339,40 @@ int hash_table_dtor(HashTable* table)
     }
     SAFE_BLOCK_END
 
-    /*for (size_t i = 0; i < table->bucket_count; ++i)
-    {
-        HashTableEntry* entry = table->buckets[i].next;
-         while (entry)
-        {
-            free(entry->key);
-            entry = entry->next;
-        }
-    }*/
     free(table->buckets);
+    free(table->old_buckets);
+
+    for (size_t i = 0; i < table->slab_count; ++i)
+        free(table->slabs[i]);
+    free(table->slabs);
+
+    for (size_t i = 0; i < table->arena.block_count; ++i)
+        free(table->arena.blocks[i]);
+    free(table->arena.blocks);
 
     memset(table, 0, sizeof(*table));
 
     return 0;
 }
 
-int hash_table_key_increment_counter(HashTable* table, const char* key)
+int hash_table_set_max_load_factor(HashTable* table, double factor)
+{
+    if (!table) return -1;
+
+    table->max_load_factor = factor;
+    return 0;
+}
+
+int hash_table_set_reducer(HashTable* table, HashTableReducer reducer)
 {
     SAFE_BLOCK_START
     {
         ASSERT_TRUE(table != NULL);
         ASSERT_TRUE(table->buckets != NULL);
-        ASSERT_TRUE(key   != NULL);
+        ASSERT_TRUE(table->distinct_count == 0);
+        ASSERT_ZERO(
+            bucket_reducer_init(&table->reducer, table->bucket_count,
+                                reducer));
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -176,46 +382,74 @@ int hash_table_key_increment_counter(HashTable* table, const char* key)
     }
     SAFE_BLOCK_END
 
-    size_t key_hash = hash_murmur(key) % table->bucket_count;
-    HashTableEntry* key_entry = find_parent_node(table, key, key_hash)->next;
+    return 0;
+}
 
-    if (key_entry)
+int hash_table_reserve(HashTable* table, size_t expected_distinct)
+{
+    SAFE_BLOCK_START
     {
-        ++ key_entry->count;
-        ++ table->total_count;
-        return 0;
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
     }
+    SAFE_BLOCK_END
 
-    SAFE_BLOCK_START
+    /* Lookups do not move buckets, so pending rehash is finished here
+     * instead of leaving them to search both bucket arrays */
+    finish_rehash(table);
+
+    while (table->capacity < expected_distinct)
     {
-        ASSERT_ZERO(
-                try_grow(table));
+        if (allocate_slab(table) < 0)
+        {
+            // TODO: Logs
+            errno = ENOMEM;
+            return -1;
+        }
     }
-    SAFE_BLOCK_HANDLE_ERRORS
+
+    /* Bucket count is fixed, if growth is disabled */
+    if (table->max_load_factor <= 0)
+        return 0;
+
+    size_t bucket_count = (size_t) ((double) expected_distinct
+                                    / table->max_load_factor);
+    if (bucket_count <= table->bucket_count)
+        return 0;
+
+    switch (table->reducer.kind)
+    {
+    case HASH_TABLE_REDUCER_FASTMOD:
+        bucket_count = next_prime(bucket_count);
+        break;
+    case HASH_TABLE_REDUCER_FIBONACCI:
+        /* Round up to power of two, keeping exact powers as they are */
+        bucket_count = 1ull << (64 - __builtin_clzll(bucket_count - 1));
+        break;
+    case HASH_TABLE_REDUCER_MULTIPLY_SHIFT:
+    default:
+        break;
+    }
+
+    if (start_rehash(table, bucket_count) < 0)
     {
         // TODO: Logs
         errno = ENOMEM;
         return -1;
     }
-    SAFE_BLOCK_END
 
-    key_entry = table->free;
-    table->free = table->free->next;
-    
-    memcpy(key_entry->key, key, sizeof(char) * max_word_length);
-    // key_entry->key = strdup(key);
-    key_entry->count = 1;
-    key_entry->next = table->buckets[key_hash].next;
-    
-    table->buckets[key_hash].next = key_entry;
-    ++ table->buckets[key_hash].count;
-    ++ table->distinct_count;
-    ++ table->total_count;
+    finish_rehash(table);
 
     return 0;
 }
 
-int hash_table_key_decrement_counter(HashTable* table, const char* key)
+int hash_table_key_increment_counter(HashTable* table, const char* key)
 {
     SAFE_BLOCK_START
     {
@@ -231,15 +465,20 @@ int hash_table_key_decrement_counter(HashTable* table, const char* key)
     }
     SAFE_BLOCK_END
 
-    size_t key_hash = hash_murmur(key) % table->bucket_count;
-
-    HashTableEntry* lst_entry = find_parent_node(table, key, key_hash);
-    HashTableEntry* key_entry = lst_entry->next;
+    const uint32_t key_length = get_key_length(key);
+    return increment_counter(table, key, key_length,
+                             hash_key(key, key_length), 1);
+}
 
+int hash_table_key_increment_counter_n(HashTable* table,
+                                       const char* key, size_t length)
+{
     SAFE_BLOCK_START
     {
-        ASSERT_TRUE(key_entry != NULL);
-        ASSERT_POSITIVE(key_entry->count);
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(key   != NULL);
+        ASSERT_TRUE(length <= max_word_length);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -249,189 +488,1039 @@ int hash_table_key_decrement_counter(HashTable* table, const char* key)
     }
     SAFE_BLOCK_END
 
-    -- key_entry->count;
-    -- table->total_count;
-
-    if (key_entry->count)
-        return 0;
-
-    lst_entry->next = key_entry->next;
-    -- table->buckets[key_hash].count;
-    -- table->distinct_count;
-
-    // free(key_entry->key);
-    // key_entry->key = NULL;
-    memset(key_entry->key, 0, max_word_length);
-    key_entry->count = 0;
-
-    key_entry->next = table->free;
-    key_entry->is_free = 1;
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
 
-    table->free = key_entry;
-    
-    return 0;
+    return increment_counter(table, padded.data, (uint32_t) length,
+                             hash_key(padded.data, (uint32_t) length), 1);
 }
 
-size_t hash_table_get_key_count(const HashTable* table, const char* key)
+int hash_table_key_increase_counter_n(HashTable* table,
+                                      const char* key, size_t length,
+                                      size_t amount)
 {
-    /* If there is no table, it does not contain any keys */
-    if (!table || !table->buckets) return 0;
-
-    /* If there is no key, no table contains it */
-    if (!key) return 0;
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(key   != NULL);
+        ASSERT_TRUE(length <= max_word_length);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
 
-    size_t key_hash = hash_murmur(key) % table->bucket_count;
+    if (amount == 0)
+        return 0;
 
-    HashTableEntry* key_entry = find_parent_node(table, key, key_hash)->next;
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
 
-    return key_entry ? key_entry->count : 0;
+    return increment_counter(table, padded.data, (uint32_t) length,
+                             hash_key(padded.data, (uint32_t) length),
+                             amount);
 }
 
-int hash_table_get_iterator(const HashTable* table, HashTableIterator* it)
+int hash_table_key_increment_counter_batch(HashTable* table,
+                                           const char* const* keys,
+                                           size_t key_count)
 {
     SAFE_BLOCK_START
     {
         ASSERT_TRUE(table != NULL);
         ASSERT_TRUE(table->buckets != NULL);
-        ASSERT_TRUE(it != NULL);
+        ASSERT_TRUE(keys  != NULL || key_count == 0);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
         // TODO: Logs
+        errno = EINVAL;
         return -1;
     }
     SAFE_BLOCK_END
 
-    it->table = table;
-    it->entry = NULL;
-    it->index = 0;
-    it->key = NULL;
-    it->count = 0;
+    uint32_t lengths[batch_chunk_size] = {};
+    uint64_t hashes [batch_chunk_size] = {};
+    uint32_t entries[batch_chunk_size] = {};
+
+    for (size_t start = 0; start < key_count; start += batch_chunk_size)
+    {
+        const size_t chunk = key_count - start < batch_chunk_size
+                                ? key_count - start
+                                : batch_chunk_size;
 
-    for (size_t i = 0; i < table->bucket_count; ++i)
-        if (table->buckets[i].next)
+        SAFE_BLOCK_START
         {
-            it->entry = table->buckets[i].next;
-            it->key = it->entry->key;
-            it->count = it->entry->count;
-            it->index = i;
-            return 0;
+            for (size_t i = 0; i < chunk; ++i)
+                ASSERT_TRUE(keys[start + i] != NULL);
         }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            // TODO: Logs
+            errno = EINVAL;
+            return -1;
+        }
+        SAFE_BLOCK_END
 
-    return -1;
-}
-
-int hash_table_iterator_has_next(const HashTableIterator* it)
-{
-    if (!it || !it->entry) return 0;
+        find_entries(table, keys + start, chunk, lengths, hashes, entries);
 
-    if (it->entry->next) return 1;
+        /* Insertions neither move nor remove existing entries, so found
+         * entries stay valid. Absent keys are inserted in order, and
+         * repeated absent keys are found by synchronous lookup */
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            if (entries[i] == hash_table_null_index)
+            {
+                if (increment_counter(table, keys[start + i],
+                                      lengths[i], hashes[i], 1) < 0)
+                    return -1;
+                continue;
+            }
+
+            rehash_step(table);
+            ++ *get_count(table, entries[i]);
+            ++ table->total_count;
+        }
+    }
 
-    for (size_t i = it->index + 1; i < it->table->bucket_count; ++i)
-        if (it->table->buckets[i].next)
-            return 1;
+    /* Batches are usually followed by lookups, which never advance rehash
+     * themselves, so rehash started by batch is not left pending */
+    finish_rehash(table);
 
     return 0;
 }
 
-int hash_table_iterator_get_next(HashTableIterator* it)
+int hash_table_key_decrement_counter(HashTable* table, const char* key)
 {
-    if (!it || !it->entry) return -1;
-
-    if (it->entry->next)
+    SAFE_BLOCK_START
     {
-        it->entry = it->entry->next;
-        it->key = it->entry->key;
-        it->count = it->entry->count;
-        return 0;
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(key   != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
     }
+    SAFE_BLOCK_END
 
-    for (size_t i = it->index + 1; i < it->table->bucket_count; ++i)
-        if (it->table->buckets[i].next)
-        {
-            it->index = i;
-            it->entry = it->table->buckets[i].next;
-            it->key = it->entry->key;
-            it->count = it->entry->count;
-            return 0;
-        }
-    return -1;
+    return decrement_counter(table, key, get_key_length(key));
 }
 
-static HashTableEntry* find_parent_node(const HashTable* table,
-                                        const char* key, uint64_t key_hash)
+int hash_table_key_decrement_counter_n(HashTable* table,
+                                       const char* key, size_t length)
 {
-    __m512i key_vec = _mm512_load_si512(key);
-
-    HashTableEntry* lst_entry = &table->buckets[key_hash];
-    HashTableEntry* key_entry = lst_entry->next;
-
-    while (key_entry)
+    SAFE_BLOCK_START
     {
-        __m512i cur = _mm512_load_si512(key_entry->key);
-        __mmask64 cmp_mask = _mm512_cmpeq_epi8_mask(key_vec, cur);
-        if (!~cmp_mask) break;
-
-        lst_entry = key_entry;
-        key_entry = lst_entry->next;
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(key   != NULL);
+        ASSERT_TRUE(length <= max_word_length);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
     }
+    SAFE_BLOCK_END
 
-    return lst_entry;
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
+
+    return decrement_counter(table, padded.data, (uint32_t) length);
 }
 
-static void mark_free(HashTableEntry* entries, size_t entry_count)
+size_t hash_table_get_key_count(const HashTable* table, const char* key)
 {
-    for (size_t i = 0; i < entry_count; ++i)
-    {
-        entries[i].is_free = 1;
-        entries[i].next = i + 1 < entry_count
-                            ? entries + i + 1
-                            : NULL;
-    }
-}
+    /* If there is no table, it does not contain any keys */
+    if (!table || !table->buckets) return 0;
 
+    /* If there is no key, no table contains it */
+    if (!key) return 0;
 
-static int try_grow(HashTable* table)
+    return find_count(table, key, get_key_length(key));
+}
+
+size_t hash_table_get_key_count_n(const HashTable* table,
+                                  const char* key, size_t length)
 {
-    const size_t cap_growth = 2;
-    if (table->free) return 0;
+    /* If there is no table, it does not contain any keys */
+    if (!table || !table->buckets) return 0;
 
-    const intptr_t old_addr = (intptr_t) table->buckets;
+    /* Keys, which are missing or too long, are not in table */
+    if (!key || length > max_word_length) return 0;
 
-    const size_t old_cap = table->capacity;
-    const size_t new_cap = old_cap * cap_growth;
-    HashTableEntry* data = NULL;
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
 
+    return find_count(table, padded.data, (uint32_t) length);
+}
+
+int hash_table_get_key_count_batch(const HashTable* table,
+                                   const char* const* keys, size_t key_count,
+                                   size_t* counts)
+{
     SAFE_BLOCK_START
     {
-        ASSERT_ZERO(
-                posix_memalign((void**)&data,
-                                max_word_length, new_cap*sizeof(*data)));
-        free(table->buckets);
-        memset(data, 0, new_cap*sizeof(*data));
+        ASSERT_TRUE(table  != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(keys   != NULL || key_count == 0);
+        ASSERT_TRUE(counts != NULL || key_count == 0);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
         // TODO: Logs
+        errno = EINVAL;
         return -1;
     }
     SAFE_BLOCK_END
 
-    const intptr_t new_addr = (intptr_t) data;
-    const intptr_t addr_offset = new_addr - old_addr;
+    uint32_t lengths[batch_chunk_size] = {};
+    uint64_t hashes [batch_chunk_size] = {};
+    uint32_t entries[batch_chunk_size] = {};
 
-    /* Update addresses */
-    if (addr_offset)
-        for (size_t i = 0; i < old_cap; ++i)
-            if (data[i].next)
-                data[i].next = (HashTableEntry*)
-                                        ((intptr_t)data[i].next + addr_offset);
+    for (size_t start = 0; start < key_count; start += batch_chunk_size)
+    {
+        const size_t chunk = key_count - start < batch_chunk_size
+                                ? key_count - start
+                                : batch_chunk_size;
 
-    mark_free(data + old_cap, new_cap - old_cap);
+        find_entries(table, keys + start, chunk, lengths, hashes, entries);
 
-    table->buckets = data;
-    table->free = data + old_cap;
-    table->capacity = new_cap;
+        for (size_t i = 0; i < chunk; ++i)
+            counts[start + i] = entries[i] != hash_table_null_index
+                                    ? *get_count(table, entries[i])
+                                    : 0;
+    }
 
     return 0;
 }
+
+int hash_table_get_iterator(const HashTable* table, HashTableIterator* it)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(it != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    it->table = table;
+    it->index = 0;
+    it->key = NULL;
+    it->count = 0;
+
+    if (!table->distinct_count)
+        return -1;
+
+    set_iterator_entry(it, 0);
+    return 0;
+}
+
+int hash_table_iterator_has_next(const HashTableIterator* it)
+{
+    if (!it || !it->key) return 0;
+
+    return it->index + 1 < it->table->distinct_count;
+}
+
+int hash_table_iterator_get_next(HashTableIterator* it)
+{
+    if (!it || !it->key) return -1;
+
+    if (it->index + 1 >= it->table->distinct_count)
+        return -1;
+
+    set_iterator_entry(it, it->index + 1);
+    return 0;
+}
+
+int hash_table_merge_begin(HashTableMerge* merge, HashTable* table,
+                           HashTable* const* sources, size_t source_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(sources != NULL || source_count == 0);
+        for (size_t i = 0; i < source_count; ++i)
+            ASSERT_TRUE(sources[i] != NULL && sources[i]->buckets != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    size_t distinct_count = table->distinct_count;
+    size_t block_count = table->arena.block_count;
+    for (size_t i = 0; i < source_count; ++i)
+    {
+        distinct_count += sources[i]->distinct_count;
+        block_count += sources[i]->arena.block_count;
+    }
+
+    HashTableMergeSource* merge_sources = NULL;
+
+    /* Reservation also finishes pending rehash, so that entries are
+     * linked into a single bucket array */
+    SAFE_BLOCK_START
+    {
+        ASSERT_SIMPLE(
+            merge_sources = (HashTableMergeSource*)
+                        calloc(source_count + 1, sizeof(*merge_sources)),
+            action_result != NULL);
+        ASSERT_ZERO(
+            hash_table_reserve(table, distinct_count));
+        ASSERT_ZERO(
+            reserve_arena_blocks(&table->arena, block_count));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        free(merge_sources);
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    size_t first_index = table->distinct_count;
+    for (size_t i = 0; i < source_count; ++i)
+    {
+        HashTableArena* arena = &sources[i]->arena;
+
+        merge_sources[i] = {
+            .table = sources[i],
+            .first_index = first_index,
+            .arena_offset = table->arena.block_count
+                          * hash_table_arena_block_size,
+            .moved = 0
+        };
+        first_index += sources[i]->distinct_count;
+
+        /* Long keys stay in their blocks, which are taken by table */
+        if (!arena->block_count)
+            continue;
+
+        memcpy(table->arena.blocks + table->arena.block_count,
+               arena->blocks, arena->block_count * sizeof(*arena->blocks));
+        table->arena.block_count += arena->block_count;
+        table->arena.used = arena->used;
+
+        free(arena->blocks);
+        *arena = {};
+    }
+
+    merge->table = table;
+    merge->sources = merge_sources;
+    merge->source_count = source_count;
+
+    return 0;
+}
+
+int hash_table_merge_source(HashTableMerge* merge, size_t index)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(merge->table != NULL);
+        ASSERT_TRUE(index < merge->source_count);
+        ASSERT_ZERO(merge->sources[index].moved);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    HashTable* table = merge->table;
+    HashTableMergeSource* source = &merge->sources[index];
+
+    for (size_t i = 0; i < source->table->distinct_count; ++i)
+    {
+        const uint32_t from = (uint32_t) i;
+        const uint32_t to   = (uint32_t) (source->first_index + i);
+
+        const HashTableLink* from_link = get_link(source->table, from);
+        HashTableLink* link = get_link(table, to);
+
+        HashTableKey key = *get_key_slot(source->table, from);
+        if (from_link->length >= hash_table_inline_key_size)
+            key.offset += source->arena_offset;
+
+        *get_key_slot(table, to) = key;
+        *get_count(table, to) = *get_count(source->table, from);
+        link->hash = from_link->hash;
+        link->length = from_link->length;
+
+        link_entry_concurrent(table, to);
+    }
+
+    source->moved = 1;
+
+    return 0;
+}
+
+int hash_table_merge_end(HashTableMerge* merge)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(merge->table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    HashTable* table = merge->table;
+
+    for (size_t i = 0; i < merge->source_count; ++i)
+    {
+        HashTable* source = merge->sources[i].table;
+
+        if (!merge->sources[i].moved)
+            hash_table_merge_source(merge, i);
+
+        table->distinct_count += source->distinct_count;
+        table->total_count += source->total_count;
+
+        hash_table_dtor(source);
+    }
+
+    free(merge->sources);
+    *merge = {};
+
+    return 0;
+}
+
+/**
+ * @brief Find link (either bucket head or `next` field of entry), which
+ * points to entry with given key
+ *
+ * @return Address of link. Link contains `hash_table_null_index` if key
+ * was not found
+ */
+static uint32_t* find_entry_link(const HashTable* table,
+                                 HashTableBucket* bucket,
+                                 const char* key, uint32_t key_length,
+                                 uint64_t key_hash)
+{
+    uint32_t* key_link = &bucket->next;
+
+    while (*key_link != hash_table_null_index)
+    {
+        HashTableLink* link = get_link(table, *key_link);
+
+        if (link->hash == key_hash &&
+            key_matches(table, *key_link, link, key, key_length))
+            break;
+
+        key_link = &link->next;
+    }
+
+    return key_link;
+}
+
+/**
+ * @brief Increase counter of key with precomputed length and hash
+ */
+static int increment_counter(HashTable* table, const char* key,
+                             uint32_t key_length, uint64_t key_hash,
+                             size_t amount)
+{
+    rehash_step(table);
+
+    HashTableBucket* bucket = get_bucket(table, key_hash);
+    uint32_t key_index = *find_entry_link(table, bucket,
+                                          key, key_length, key_hash);
+
+    if (key_index != hash_table_null_index)
+    {
+        *get_count(table, key_index) += amount;
+        table->total_count += amount;
+        return 0;
+    }
+
+    key_index = (uint32_t) table->distinct_count;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                try_grow(table));
+        ASSERT_ZERO(
+                store_key(table, key_index, key, key_length));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    HashTableLink* link = get_link(table, key_index);
+    
+    *get_count(table, key_index) = amount;
+    link->hash = key_hash;
+    link->next = bucket->next;
+    link->length = key_length;
+    
+    bucket->next = key_index;
+    ++ bucket->count;
+    ++ table->distinct_count;
+    table->total_count += amount;
+
+    try_start_rehash(table);
+
+    return 0;
+}
+
+/**
+ * @brief Decrement counter of key with precomputed length
+ */
+static int decrement_counter(HashTable* table,
+                             const char* key, uint32_t key_length)
+{
+    rehash_step(table);
+
+    const uint64_t key_hash = hash_key(key, key_length);
+    HashTableBucket* bucket = get_bucket(table, key_hash);
+
+    uint32_t* key_link  = find_entry_link(table, bucket,
+                                          key, key_length, key_hash);
+    uint32_t  key_index = *key_link;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(key_index != hash_table_null_index);
+        ASSERT_POSITIVE(*get_count(table, key_index));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    size_t* key_count = get_count(table, key_index);
+
+    -- *key_count;
+    -- table->total_count;
+
+    if (*key_count)
+        return 0;
+
+    HashTableLink* link = get_link(table, key_index);
+
+    *key_link = link->next;
+    -- bucket->count;
+    -- table->distinct_count;
+
+    move_last_entry(table, key_index);
+    
+    return 0;
+}
+
+/**
+ * @brief Get counter of key with precomputed length
+ */
+static size_t find_count(const HashTable* table,
+                         const char* key, uint32_t key_length)
+{
+    const uint64_t key_hash = hash_key(key, key_length);
+    HashTableBucket* bucket = get_bucket(table, key_hash);
+    uint32_t key_index = *find_entry_link(table, bucket,
+                                          key, key_length, key_hash);
+
+    return key_index != hash_table_null_index
+            ? *get_count(table, key_index)
+            : 0;
+}
+
+/**
+ * @brief Start lookup of key with precomputed hash in probe slot. Lookup
+ * is suspended after prefetching key bucket
+ */
+__always_inline
+static void start_probe(const HashTable* table, HashTableProbe* probe,
+                        const char* const* keys, size_t key_index,
+                        uint64_t* hashes, uint32_t* entries)
+{
+    probe->key_index = key_index;
+
+    if (!keys[key_index])
+    {
+        entries[key_index] = hash_table_null_index;
+        probe->stage = PROBE_DONE;
+        return;
+    }
+
+    __builtin_prefetch(get_bucket(table, hashes[key_index]));
+    probe->stage = PROBE_BUCKET;
+}
+
+/**
+ * @brief Advance lookup by one memory access. If lookup is not finished,
+ * next accessed entry is prefetched and lookup is suspended
+ *
+ * @return 1 if lookup is finished, 0 otherwise
+ */
+__always_inline
+static int step_probe(const HashTable* table, HashTableProbe* probe,
+                      const char* const* keys, const uint32_t* lengths,
+                      const uint64_t* hashes, uint32_t* entries)
+{
+    const uint64_t key_hash = hashes[probe->key_index];
+    uint32_t next = hash_table_null_index;
+
+    if (probe->stage == PROBE_BUCKET)
+    {
+        next = get_bucket(table, key_hash)->next;
+    }
+    else
+    {
+        const HashTableLink* link = get_link(table, probe->entry);
+
+        if (link->hash == key_hash &&
+            key_matches(table, probe->entry, link,
+                        keys[probe->key_index], lengths[probe->key_index]))
+        {
+            entries[probe->key_index] = probe->entry;
+            probe->stage = PROBE_DONE;
+            return 1;
+        }
+
+        next = link->next;
+    }
+
+    if (next == hash_table_null_index)
+    {
+        entries[probe->key_index] = hash_table_null_index;
+        probe->stage = PROBE_DONE;
+        return 1;
+    }
+
+    __builtin_prefetch(get_link    (table, next));
+    __builtin_prefetch(get_key_slot(table, next));
+    probe->entry = next;
+    probe->stage = PROBE_CHAIN;
+    return 0;
+}
+
+/**
+ * @brief Find entries of keys, keeping several lookups in flight. Each
+ * lookup is suspended at every chain hop after prefetching next entry,
+ * and other lookups proceed while it is being loaded
+ *
+ * @param[out] lengths  - Lengths of keys
+ * @param[out] hashes   - Hashes of keys
+ * @param[out] entries  - Indices of entries or `hash_table_null_index`
+ * for absent and NULL keys
+ */
+template <class Kernels>
+static void find_entries_impl(const HashTable* table,
+                              const char* const* keys, size_t key_count,
+                              uint32_t* lengths, uint64_t* hashes,
+                              uint32_t* entries)
+{
+    HashTableProbe probes[batch_probe_count] = {};
+    size_t started = 0;
+    size_t active  = 0;
+
+    uint32_t widths[batch_chunk_size] = {};
+    for (size_t i = 0; i < key_count; ++i)
+    {
+        if (!keys[i]) continue;
+
+        lengths[i] = get_key_length_impl<Kernels>(keys[i]);
+        widths [i] = (uint32_t) get_key_width(lengths[i]);
+    }
+
+    /* Keys of all widths are hashed together, matching `hash_key` */
+    TableHashPolicy::hash_prefix_batch(keys, widths, key_count, hashes);
+
+    for (size_t i = 0; i < batch_probe_count; ++i)
+    {
+        while (started < key_count && probes[i].stage == PROBE_DONE)
+            start_probe(table, &probes[i], keys, started++, hashes, entries);
+
+        if (probes[i].stage != PROBE_DONE)
+            ++ active;
+    }
+
+    while (active)
+    {
+        for (size_t i = 0; i < batch_probe_count; ++i)
+        {
+            HashTableProbe* probe = &probes[i];
+            if (probe->stage == PROBE_DONE)
+                continue;
+
+            if (!step_probe(table, probe, keys, lengths, hashes, entries))
+                continue;
+
+            -- active;
+
+            /* Reuse finished slot for next key */
+            while (started < key_count && probe->stage == PROBE_DONE)
+                start_probe(table, probe, keys, started++, hashes, entries);
+
+            if (probe->stage != PROBE_DONE)
+                ++ active;
+        }
+    }
+}
+
+KEY_KERNELS_DISPATCH(void, find_entries,
+                     (const HashTable* table,
+                      const char* const* keys, size_t key_count,
+                      uint32_t* lengths, uint64_t* hashes,
+                      uint32_t* entries),
+                     (table, keys, key_count, lengths, hashes, entries))
+
+/**
+ * @brief Allocate new slab of entries if all entries are used
+ */
+static int try_grow(HashTable* table)
+{
+    if (table->distinct_count < table->capacity) return 0;
+
+    return allocate_slab(table);
+}
+
+/**
+ * @brief Add one slab to entry pool
+ */
+static int allocate_slab(HashTable* table)
+{
+    const size_t slab_array_growth = 2;
+
+    /* Last index is reserved for `hash_table_null_index` */
+    if (table->capacity + hash_table_slab_size > hash_table_null_index)
+    {
+        // TODO: Logs
+        return -1;
+    }
+
+    if (table->slab_count == table->slab_array_size)
+    {
+        const size_t new_size = table->slab_array_size
+                              ? table->slab_array_size * slab_array_growth
+                              : 1;
+        HashTableSlab** slabs = (HashTableSlab**)
+                        realloc(table->slabs, new_size * sizeof(*slabs));
+        if (!slabs)
+        {
+            // TODO: Logs
+            return -1;
+        }
+
+        table->slabs = slabs;
+        table->slab_array_size = new_size;
+    }
+
+    HashTableSlab* slab = NULL;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                posix_memalign((void**)&slab, max_word_length,
+                                sizeof(*slab)));
+        memset(slab, 0, sizeof(*slab));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    table->slabs[table->slab_count++] = slab;
+    table->capacity += hash_table_slab_size;
+
+    return 0;
+}
+
+/**
+ * @brief Copy key into entry, or into key arena if it does not fit
+ * into entry. Long keys are zero-padded to their width, and one more
+ * chunk of `hash_table_inline_key_size` is added, if it is needed for
+ * terminating zero
+ */
+static int store_key(HashTable* table, uint32_t index,
+                     const char* key, uint32_t key_length)
+{
+    const size_t block_array_growth = 2;
+
+    HashTableKey* slot = get_key_slot(table, index);
+
+    if (key_length < hash_table_inline_key_size)
+    {
+        memcpy(slot->data, key, hash_table_inline_key_size);
+        return 0;
+    }
+
+    HashTableArena* arena = &table->arena;
+    const size_t width = get_key_width(key_length);
+    const size_t size  = key_length < width
+                            ? width
+                            : width + hash_table_inline_key_size;
+
+    if (!arena->block_count
+        || arena->used + size > hash_table_arena_block_size)
+    {
+        if (arena->block_count == arena->block_array_size)
+        {
+            const size_t new_size = arena->block_array_size
+                                  ? arena->block_array_size
+                                        * block_array_growth
+                                  : 1;
+            char** blocks = (char**) realloc(arena->blocks,
+                                             new_size * sizeof(*blocks));
+            if (!blocks)
+            {
+                // TODO: Logs
+                return -1;
+            }
+
+            arena->blocks = blocks;
+            arena->block_array_size = new_size;
+        }
+
+        char* block = NULL;
+
+        SAFE_BLOCK_START
+        {
+            ASSERT_ZERO(
+                    posix_memalign((void**)&block, hash_table_inline_key_size,
+                                   hash_table_arena_block_size));
+            memset(block, 0, hash_table_arena_block_size);
+        }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            // TODO: Logs
+            return -1;
+        }
+        SAFE_BLOCK_END
+
+        arena->blocks[arena->block_count++] = block;
+        arena->used = 0;
+    }
+
+    slot->offset = (arena->block_count - 1) * hash_table_arena_block_size
+                 + arena->used;
+    memcpy(get_arena_key(table, slot->offset), key, key_length);
+    arena->used += size;
+
+    return 0;
+}
+
+/**
+ * @brief Make room for `block_count` blocks in arena block array
+ */
+static int reserve_arena_blocks(HashTableArena* arena, size_t block_count)
+{
+    if (block_count <= arena->block_array_size)
+        return 0;
+
+    char** blocks = (char**) realloc(arena->blocks,
+                                     block_count * sizeof(*blocks));
+    if (!blocks)
+    {
+        // TODO: Logs
+        return -1;
+    }
+
+    arena->blocks = blocks;
+    arena->block_array_size = block_count;
+
+    return 0;
+}
+
+/**
+ * @brief Push entry with filled hash to the head of its chain. Entries
+ * may be pushed by several threads at once, if there is no rehash in
+ * progress
+ */
+static void link_entry_concurrent(HashTable* table, uint32_t index)
+{
+    HashTableLink* link = get_link(table, index);
+    HashTableBucket* bucket = get_bucket(table, link->hash);
+
+    uint32_t head = __atomic_load_n(&bucket->next, __ATOMIC_RELAXED);
+    do
+        link->next = head;
+    while (!__atomic_compare_exchange_n(&bucket->next, &head, index, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    __atomic_fetch_add(&bucket->count, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Fill the hole left by removed entry at `index` with the last entry
+ * of the table. Removed entry must be already unlinked from its chain and
+ * `distinct_count` must already be decremented
+ */
+static void move_last_entry(HashTable* table, uint32_t index)
+{
+    const uint32_t last = (uint32_t) table->distinct_count;
+
+    if (index != last)
+    {
+        HashTableLink* last_link = get_link(table, last);
+
+        uint32_t* link_to_last = &get_bucket(table, last_link->hash)->next;
+        while (*link_to_last != last)
+            link_to_last = &get_link(table, *link_to_last)->next;
+
+        *link_to_last = index;
+
+        *get_key_slot(table, index) = *get_key_slot(table, last);
+        *get_count(table, index) = *get_count(table, last);
+        *get_link(table, index) = *last_link;
+    }
+
+    *get_key_slot(table, last) = {};
+    *get_count(table, last) = 0;
+}
+
+static HashTableBucket* allocate_buckets(size_t bucket_count)
+{
+    HashTableBucket* buckets = (HashTableBucket*) calloc(bucket_count,
+                                                         sizeof(*buckets));
+    if (!buckets)
+        return NULL;
+
+    for (size_t i = 0; i < bucket_count; ++i)
+        buckets[i].next = hash_table_null_index;
+
+    return buckets;
+}
+
+/**
+ * @brief Allocate larger bucket array if load factor is exceeded. Entries
+ * are then moved to it by `rehash_step()`
+ */
+static void try_start_rehash(HashTable* table)
+{
+    if (table->old_buckets || table->max_load_factor <= 0)
+        return;
+
+    if ((double) table->distinct_count
+            <= table->max_load_factor * (double) table->bucket_count)
+        return;
+
+    /* Only power-of-two sizes keep their reducer valid when doubled,
+     * others are kept prime to stay friendly to weak hash functions */
+    const size_t new_count =
+            table->reducer.kind == HASH_TABLE_REDUCER_FASTMOD
+                ? next_prime(2*table->bucket_count)
+                : 2*table->bucket_count;
+
+    /* Table stays usable with longer chains, so failure is not an error */
+    start_rehash(table, new_count);
+}
+
+/**
+ * @brief Allocate new bucket array of given size. Entries are then moved
+ * to it by `rehash_step()`. There must be no rehash in progress
+ */
+static int start_rehash(HashTable* table, size_t bucket_count)
+{
+    BucketReducer reducer = {};
+    if (bucket_reducer_init(&reducer, bucket_count, table->reducer.kind) < 0)
+        return -1;
+
+    HashTableBucket* buckets = allocate_buckets(bucket_count);
+    if (!buckets)
+        return -1;
+
+    table->old_buckets = table->buckets;
+    table->old_bucket_count = table->bucket_count;
+    table->old_reducer = table->reducer;
+    table->rehash_index = 0;
+
+    table->buckets = buckets;
+    table->bucket_count = bucket_count;
+    table->reducer = reducer;
+
+    return 0;
+}
+
+/**
+ * @brief Move several buckets from old bucket array to the new one
+ */
+static void rehash_step(HashTable* table)
+{
+    const size_t buckets_per_step = 4;
+
+    if (!table->old_buckets)
+        return;
+
+    for (size_t i = 0; i < buckets_per_step
+                    && table->rehash_index < table->old_bucket_count; ++i)
+    {
+        HashTableBucket* old_bucket =
+                            &table->old_buckets[table->rehash_index++];
+        uint32_t index = old_bucket->next;
+
+        while (index != hash_table_null_index)
+        {
+            HashTableLink* link = get_link(table, index);
+            const uint32_t next = link->next;
+            HashTableBucket* bucket = &table->buckets[
+                        bucket_reducer_apply(&table->reducer, link->hash)];
+
+            link->next = bucket->next;
+            bucket->next = index;
+            ++ bucket->count;
+
+            index = next;
+        }
+
+        old_bucket->next = hash_table_null_index;
+        old_bucket->count = 0;
+    }
+
+    if (table->rehash_index < table->old_bucket_count)
+        return;
+
+    free(table->old_buckets);
+    table->old_buckets = NULL;
+    table->old_bucket_count = 0;
+    table->rehash_index = 0;
+}
+
+/**
+ * @brief Move all buckets, which are left in old bucket array
+ */
+static void finish_rehash(HashTable* table)
+{
+    while (table->old_buckets)
+        rehash_step(table);
+}
+
+#endif /* HASH_TABLE_SWISS */
@@ -14,49 +14,258 @@
 
 #include <stddef.h>
 
-struct HashTableEntry;
+#include <stdint.h>
+
+#include "bucket_reducer.h"
 
 static constexpr size_t max_word_length = 64;
 
-struct HashTableEntry
+static constexpr double hash_table_default_load_factor = 1.0;
+
+/**
+ * @brief Key in format accepted by hash table: aligned and padded with
+ * zeros to `max_word_length` bytes
+ */
+struct PaddedKey
+{
+    char data[max_word_length] __attribute__((aligned (max_word_length)));
+};
+
+static constexpr size_t hash_table_slab_size = 512;
+static_assert((hash_table_slab_size & (hash_table_slab_size - 1)) == 0,
+              "Slab size must be a power of two");
+
+#ifdef HASH_TABLE_SWISS
+
+/*
+ * Open-addressing engine. Every slot has a 1-byte control tag stored in a
+ * separate `control` array: either `swiss_ctrl_empty`, `swiss_ctrl_deleted`
+ * or low 7 bits of key hash. Tags are checked a whole group at a time, so
+ * a lookup usually performs a single full key comparison.
+ */
+
+static constexpr size_t swiss_group_width = 64;
+
+static constexpr uint8_t swiss_ctrl_empty   = 0x80;
+static constexpr uint8_t swiss_ctrl_deleted = 0xFE;
+
+struct HashTableSlot
 {
     char key[max_word_length] __attribute__((aligned (max_word_length)));
-    size_t count; 
-    int is_free;
+};
+
+struct HashTable
+{
+    uint8_t* control;
+    HashTableSlot* slots;
+    size_t* counts;
+
+    size_t group_count;
+    size_t capacity;
+    size_t growth_left;
 
-    HashTableEntry* next;
-} __attribute__((aligned (max_word_length)));
+    double max_load_factor;
+
+    size_t distinct_count;
+    size_t total_count;
+};
+
+/*
+ * Iterator key points into table slot. It is zero-terminated, unless it is
+ * `max_word_length` bytes long
+ */
+struct HashTableIterator
+{
+    const HashTable* table;
+    size_t index;
+
+    const char* key;
+    size_t count;
+};
+
+struct HashTableMergeSource
+{
+    HashTable* table;
+    int moved;
+};
+
+/*
+ * Slots of merged table are claimed by atomic update of their control
+ * bytes, so sources do not need to be assigned parts of table
+ */
+struct HashTableMerge
+{
+    HashTable* table;
+
+    HashTableMergeSource* sources;
+    size_t source_count;
+};
 
+#else
+
+/*
+ * Entries are linked by their indices in the entry pool, so the table does
+ * not contain any pointers into itself.
+ */
+static constexpr uint32_t hash_table_null_index = UINT32_MAX;
+
+/*
+ * Keys shorter than `hash_table_inline_key_size` are stored inside entry
+ * with terminating zero. Longer keys are stored in key arena and entry
+ * keeps their offset.
+ */
+static constexpr size_t hash_table_inline_key_size = 16;
+
+static constexpr size_t hash_table_arena_block_size = 1 << 16;
+static_assert(hash_table_arena_block_size % hash_table_inline_key_size == 0,
+              "Arena block must consist of whole key chunks");
+
+union HashTableKey
+{
+    char data[hash_table_inline_key_size]
+                __attribute__((aligned (hash_table_inline_key_size)));
+    uint64_t offset;
+};
+
+/*
+ * Full key hash is kept in entry link and compared before the key itself,
+ * so chain walk does not touch keys of non-matching entries
+ */
+struct HashTableLink
+{
+    uint64_t hash;
+    uint32_t next;
+    uint32_t length;
+};
+
+/*
+ * Long keys are allocated one after another in blocks of
+ * `hash_table_arena_block_size` bytes. Each key is zero-padded to a
+ * multiple of `hash_table_inline_key_size` and never crosses block
+ * boundary. Space of removed keys is reused only after table is destroyed.
+ */
+struct HashTableArena
+{
+    char** blocks;
+    size_t block_count;
+    size_t block_array_size;
+
+    size_t used;
+};
+
+/*
+ * Entries are stored as a structure of arrays: chain walks touch only
+ * links, and counting passes touch only counts
+ */
+struct HashTableSlab
+{
+    HashTableKey  keys  [hash_table_slab_size];
+    HashTableLink links [hash_table_slab_size];
+    size_t        counts[hash_table_slab_size];
+};
+
+struct HashTableBucket
+{
+    uint32_t next;
+    uint32_t count;
+};
+
+/*
+ * Entries are allocated in slabs of `hash_table_slab_size` entries. Slabs
+ * are never moved or freed until table is destroyed, so growing the table
+ * does not touch existing entries.
+ *
+ * Entries are kept dense in insertion order: indices `0..distinct_count-1`
+ * are occupied. Removed entry is replaced with the last one.
+ *
+ * When load factor is exceeded, a new bucket array is allocated and the
+ * entries are moved from `old_buckets` a few buckets at a time by each
+ * modifying operation. Buckets before `rehash_index` are already moved.
+ * Lookups do not move buckets, so batch insertion and reservation finish
+ * pending rehash before returning.
+ *
+ * Hash is reduced to bucket index by `reducer` (`old_reducer` for old
+ * bucket array) instead of division.
+ *
+ * Keys, which do not fit into entry, are stored in `arena`.
+ */
 struct HashTable
 {
-    HashTableEntry* buckets;
+    HashTableBucket* buckets;
     size_t bucket_count;
+    BucketReducer reducer;
 
-    HashTableEntry* free;
+    HashTableBucket* old_buckets;
+    size_t old_bucket_count;
+    BucketReducer old_reducer;
+    size_t rehash_index;
+
+    double max_load_factor;
+
+    HashTableSlab** slabs;
+    size_t slab_count;
+    size_t slab_array_size;
+
+    HashTableArena arena;
 
     size_t capacity;
     size_t distinct_count;
     size_t total_count;
 };
 
+/*
+ * Iterator key is zero-terminated but, unlike keys passed to table, is not
+ * padded to `max_word_length` bytes
+ */
 struct HashTableIterator
 {
     const HashTable* table;
-    const HashTableEntry* entry;
     size_t index;
 
     const char* key;
     size_t count;
 };
 
+/*
+ * Entries of source take indices starting from `first_index` in merged
+ * table. Arena blocks of source are appended to arena of merged table, so
+ * offsets of its long keys are increased by `arena_offset`
+ */
+struct HashTableMergeSource
+{
+    HashTable* table;
+    size_t first_index;
+    uint64_t arena_offset;
+    int moved;
+};
+
+/*
+ * Every source owns its range of entries of merged table, and only chain
+ * heads are updated by several threads, atomically
+ */
+struct HashTableMerge
+{
+    HashTable* table;
+
+    HashTableMergeSource* sources;
+    size_t source_count;
+};
+
+#endif
+
 /**
  * @brief Create and initialize new hash table
  *
- * @param[out] table	- Hash table instance to be initialized
+ * @param[out] table	        - Hash table instance to be initialized
+ * @param[in]  bucket_count   - Initial number of buckets. Power-of-two
+ *                              counts use Fibonacci reducer, others use
+ *                              fastmod. Open-addressing engine treats it
+ *                              as initial capacity hint
  *
  * @return 0 upon success, -1 upon error. Check `errno` for error description
  *
- * @exception EINVAL    - table was NULL or bucket_count is not a prime number
+ * @exception EINVAL    - table was NULL or bucket_count is 0 or exceeds
+ *                        `bucket_reducer_max_size`
  * @exception ENOMEM    - failed to allocate memory for table
  */
 int hash_table_ctor(HashTable* table, size_t bucket_count);
@@ -70,6 +279,50 @@ int hash_table_ctor(HashTable* table, size_t bucket_count);
  */
 int hash_table_dtor(HashTable* table);
 
+/**
+ * @brief Set maximum ratio of distinct keys to buckets. Exceeding it makes
+ * table grow its bucket array
+ *
+ * @param[inout] table	    - Hash table to be configured
+ * @param[in]    factor     - New maximum load factor. Non-positive value
+ *                              disables automatic growth of bucket array.
+ *                              Open-addressing engine caps it at 7/8 and
+ *                              cannot disable growth
+ *
+ * @return 0 upon success, -1 if `table` is NULL
+ */
+int hash_table_set_max_load_factor(HashTable* table, double factor);
+
+/**
+ * @brief Set method of reducing hash to bucket index. By default it is
+ * chosen by `hash_table_ctor` based on bucket count
+ *
+ * @param[inout] table	    - Empty hash table to be configured
+ * @param[in]    reducer    - Reduction method
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL or not empty, or reducer does not
+ *                        support its bucket count
+ * @exception ENOTSUP   - table uses open-addressing engine
+ */
+int hash_table_set_reducer(HashTable* table, HashTableReducer reducer);
+
+/**
+ * @brief Prepare table to hold given number of distinct keys without
+ * growing. If growth is disabled by `hash_table_set_max_load_factor`,
+ * only entry storage is reserved and bucket count stays fixed
+ *
+ * @param[inout] table		    - Hash table to be resized
+ * @param[in]    expected_distinct  - Expected number of distinct keys
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL or not initialized
+ * @exception ENOMEM    - failed to allocate memory
+ */
+int hash_table_reserve(HashTable* table, size_t expected_distinct);
+
 /**
  * @brief Increment counter on entry associated with given key
  *
@@ -82,6 +335,59 @@ int hash_table_dtor(HashTable* table);
  */
 int hash_table_key_increment_counter(HashTable* table, const char* key);
 
+/**
+ * @brief Increment counter on entry associated with given key. Key is
+ * neither aligned nor padded
+ *
+ * @param[in] key	- Counted key. Must not contain zero bytes
+ * @param[in] length	- Length of key
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or key is NULL or length exceeds
+ *                        `max_word_length`
+ * @exception ENOMEM    - failed to allocate memory for entry
+ */
+int hash_table_key_increment_counter_n(HashTable* table,
+                                       const char* key, size_t length);
+
+/**
+ * @brief Add given amount to counter on entry associated with given key.
+ * Key is neither aligned nor padded. Used to merge counts of tables
+ *
+ * @param[in] key	- Counted key. Must not contain zero bytes
+ * @param[in] length	- Length of key
+ * @param[in] amount	- Value added to counter. Zero amount does not
+ *                        insert key
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or key is NULL or length exceeds
+ *                        `max_word_length`
+ * @exception ENOMEM    - failed to allocate memory for entry
+ */
+int hash_table_key_increase_counter_n(HashTable* table,
+                                      const char* key, size_t length,
+                                      size_t amount);
+
+/**
+ * @brief Increment counters on entries associated with each of given keys.
+ * Lookups of several keys are interleaved, so that their cache misses
+ * overlap
+ *
+ * @param[in] keys	    - Array of counted keys
+ * @param[in] key_count	    - Number of keys in array
+ *
+ * @return 0 upon success, -1 upon error. Upon error counters of keys
+ * preceding failed one are incremented
+ *
+ * @exception EINVAL    - table, keys or one of keys is NULL
+ * @exception ENOMEM    - failed to allocate memory for entry
+ */
+int hash_table_key_increment_counter_batch(HashTable* table,
+                                           const char* const* keys,
+                                           size_t key_count);
+
 /**
  * @brief Decrement counter on entry associated with given key
  *
@@ -92,6 +398,19 @@ int hash_table_key_increment_counter(HashTable* table, const char* key);
  */
 int hash_table_key_decrement_counter(HashTable* table, const char* key);
 
+/**
+ * @brief Decrement counter on entry associated with given key. Key is
+ * neither aligned nor padded
+ *
+ * @param[in] key	- Counted key. Must not contain zero bytes
+ * @param[in] length	- Length of key
+ *
+ * @return 0 upon success, -1 upon invalid parameter (table or key is NULL,
+ * length exceeds `max_word_length` or count of key is already 0)
+ */
+int hash_table_key_decrement_counter_n(HashTable* table,
+                                       const char* key, size_t length);
+
 /**
  * @brief Get value of counter on entry associated with given key
  *
@@ -101,6 +420,34 @@ int hash_table_key_decrement_counter(HashTable* table, const char* key);
  */
 size_t hash_table_get_key_count(const HashTable* table, const char* key);
 
+/**
+ * @brief Get value of counter on entry associated with given key. Key is
+ * neither aligned nor padded
+ *
+ * @param[in] key	- Counted key. Must not contain zero bytes
+ * @param[in] length	- Length of key. Keys longer than `max_word_length`
+ *                        are never stored in table
+ *
+ * @return Counter value
+ */
+size_t hash_table_get_key_count_n(const HashTable* table,
+                                  const char* key, size_t length);
+
+/**
+ * @brief Get values of counters on entries associated with each of given
+ * keys. Lookups of several keys are interleaved, so that their cache misses
+ * overlap
+ *
+ * @param[in] keys	    - Array of counted keys. NULL keys are counted as 0
+ * @param[in] key_count	    - Number of keys in array
+ * @param[out] counts	    - Counter values of keys
+ *
+ * @return 0 upon success, -1 if table, keys or counts is NULL
+ */
+int hash_table_get_key_count_batch(const HashTable* table,
+                                   const char* const* keys, size_t key_count,
+                                   size_t* counts);
+
 /**
  * @brief Retrieve iterator to entries of hash table
  *
@@ -130,4 +477,49 @@ int hash_table_iterator_has_next(const HashTableIterator* it);
  */
 int hash_table_iterator_get_next(HashTableIterator* it);
 
+/**
+ * @brief Prepare moving entries of several tables into one. Keys of
+ * sources must be distinct and not present in `table`. Table is reserved
+ * for all entries, so that sources can then be moved by
+ * `hash_table_merge_source()` in different threads
+ *
+ * @param[out]   merge		- Merge state
+ * @param[inout] table		- Table receiving entries
+ * @param[in]    sources	- Tables to be moved. Until merge is
+ *                              finished, they must not be used
+ * @param[in]    source_count	- Number of sources
+ *
+ * @return 0 upon success, -1 upon error. Upon error tables are left intact
+ *
+ * @exception EINVAL    - merge, table, sources or one of sources is NULL
+ *                        or not initialized
+ * @exception ENOMEM    - failed to allocate memory for entries
+ */
+int hash_table_merge_begin(HashTableMerge* merge, HashTable* table,
+                           HashTable* const* sources, size_t source_count);
+
+/**
+ * @brief Move entries of one source into merged table. Different sources
+ * may be moved by different threads at once
+ *
+ * @param[inout] merge	- Merge state
+ * @param[in]    index	- Index of source
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - merge is not started, index is out of range or
+ *                        source is already moved
+ */
+int hash_table_merge_source(HashTableMerge* merge, size_t index);
+
+/**
+ * @brief Move sources, which were not moved yet, and finish merge.
+ * Sources are destroyed
+ *
+ * @param[inout] merge	- Merge state
+ *
+ * @return 0 upon success, -1 if merge is not started
+ */
+int hash_table_merge_end(HashTableMerge* merge);
+
 #endif /* hash_table.h */
@@ -1,6 +1,9 @@
+#include <errno.h>
 #include <string.h>
+#include <immintrin.h>
 
 #include "hash_functions.h"
+#include "hash_policy.h"
 
 static constexpr size_t max_len = 64;
 
@@ -62,3 +65,302 @@ uint64_t hash_rol_xor(const char* str)
     return hash;
 }
 
+/* Reflected Castagnoli polynomial, used by SSE4.2 `crc32` instruction */
+static constexpr uint32_t crc32c_poly = 0x82F63B78;
+
+/* Offline-generated seeds of two CRC streams */
+static constexpr uint32_t crc32c_seed_lo = 0x5B1E2D37;
+static constexpr uint32_t crc32c_seed_hi = 0xC3A9F04D;
+
+struct Crc32cTable
+{
+    uint32_t values[256];
+};
+
+static constexpr Crc32cTable get_crc32c_table(void)
+{
+    Crc32cTable table = {};
+    for (uint32_t byte = 0; byte < 256; ++byte)
+    {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ ((crc & 1) ? crc32c_poly : 0);
+        table.values[byte] = crc;
+    }
+    return table;
+}
+
+static constexpr Crc32cTable crc32c_table = get_crc32c_table();
+
+__attribute__((target("sse4.2"), always_inline))
+static inline uint32_t crc32c_word_hw(uint32_t crc, uint64_t word)
+{
+    return (uint32_t) _mm_crc32_u64(crc, word);
+}
+
+__always_inline
+static uint32_t crc32c_word_sw(uint32_t crc, uint64_t word)
+{
+    for (size_t i = 0; i < sizeof(word); ++i, word >>= 8)
+        crc = crc32c_table.values[(crc ^ word) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/*
+ * Key is split between two streams, so that their dependency chains
+ * overlap. Low stream is then folded into high one, because high stream
+ * only sees zero words for short keys.
+ */
+#define CRC32C_KEY(target_name, crc32c_word)                            \
+__attribute__((target(target_name)))                                    \
+static uint64_t hash_crc32c_impl(const char* str)                       \
+{                                                                       \
+    const size_t    words = max_len / sizeof(uint64_t);                 \
+    const uint64_t* data  = (const uint64_t*) str;                      \
+                                                                        \
+    uint32_t crc_lo = crc32c_seed_lo;                                   \
+    uint32_t crc_hi = crc32c_seed_hi;                                   \
+                                                                        \
+    for (size_t i = 0; i < words; i += 2)                               \
+    {                                                                   \
+        crc_lo = crc32c_word(crc_lo, data[i]);                          \
+        crc_hi = crc32c_word(crc_hi, data[i + 1]);                      \
+    }                                                                   \
+    crc_hi = crc32c_word(crc_hi, crc_lo);                               \
+                                                                        \
+    return ((uint64_t) crc_hi << 32) | crc_lo;                          \
+}
+
+CRC32C_KEY("sse4.2",  crc32c_word_hw)
+CRC32C_KEY("default", crc32c_word_sw)
+
+#undef CRC32C_KEY
+
+uint64_t hash_crc32c(const char* str)
+{
+    return hash_crc32c_impl(str);
+}
+
+/**
+ * @brief Compute `hash_murmur_prefix` of key with width known at run time
+ */
+static inline uint64_t hash_murmur_width(const char* str, uint32_t width)
+{
+    const uint64_t mult = 0xC6A4A7935BD1E995;
+    const uint64_t seed = 0x8B72E9FB7FAA60FD;
+    const uint64_t* data = (const uint64_t *)str;
+
+    uint64_t hash = seed ^ (width * mult);
+
+    for (size_t i = 0; i < width / sizeof(uint64_t); ++i)
+    {
+        uint64_t cur_sym = data[i] * mult;
+        cur_sym ^= cur_sym >> 47;
+        cur_sym *= mult;
+
+        hash ^= cur_sym;
+        hash *= mult;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Hash one key of batch without vector instructions
+ */
+__always_inline
+static uint64_t hash_murmur_one(const char* key, const uint32_t* width)
+{
+    return width ? hash_murmur_width(key, *width) : hash_murmur(key);
+}
+
+/**
+ * @brief Compute `hash_murmur_prefix` of 8 keys at once, one key per 64-bit
+ * lane of vector register. Each lane stops hashing after its own width
+ *
+ * @param[in] keys	- Array of 8 non-NULL keys, 64 bytes each
+ * @param[in] widths	- Array of 8 key widths, NULL for full keys
+ * @param[out] hashes	- Array of 8 hashes
+ */
+__attribute__((target("avx512f,avx512dq"), always_inline))
+static inline void hash_murmur_x8(const char* const* keys,
+                                  const uint32_t* widths, uint64_t* hashes)
+{
+    const size_t   lanes = 8;
+    const uint64_t mult  = 0xC6A4A7935BD1E995;
+    const uint64_t seed  = 0x8B72E9FB7FAA60FD;
+    const size_t   len   = 64;
+
+    /* Zero-masked forms with full mask are used, because unmasked ones
+     * trigger false -Wmaybe-uninitialized in GCC headers */
+    const __mmask8 all_lanes = 0xFF;
+
+    const __m512i width = widths
+            ? _mm512_maskz_cvtepu32_epi64(all_lanes,
+                    _mm256_loadu_si256((const __m256i*) widths))
+            : _mm512_set1_epi64((long long) len);
+
+    /* Load keys as rows and transpose them, so that i-th register holds
+     * i-th 8-byte word of every key. This is cheaper than 8 gathers */
+    __m512i rows[lanes];
+    for (size_t i = 0; i < lanes; ++i)
+        rows[i] = _mm512_loadu_si512(keys[i]);
+
+    __m512i pairs[lanes];
+    for (size_t i = 0; i < lanes; i += 2)
+    {
+        pairs[i]     = _mm512_maskz_unpacklo_epi64(all_lanes,
+                                                   rows[i], rows[i + 1]);
+        pairs[i + 1] = _mm512_maskz_unpackhi_epi64(all_lanes,
+                                                   rows[i], rows[i + 1]);
+    }
+
+    const __m512i quad_lo = _mm512_set_epi64(13, 12, 5, 4, 9, 8, 1, 0);
+    const __m512i quad_hi = _mm512_set_epi64(15, 14, 7, 6, 11, 10, 3, 2);
+    __m512i quads[lanes];
+    for (size_t i = 0; i < lanes; i += 4)
+        for (size_t j = 0; j < 2; ++j)
+        {
+            quads[i + 2*j] = _mm512_permutex2var_epi64(
+                                    pairs[i + j], quad_lo, pairs[i + j + 2]);
+            quads[i + 2*j + 1] = _mm512_permutex2var_epi64(
+                                    pairs[i + j], quad_hi, pairs[i + j + 2]);
+        }
+
+    const __m512i half_lo = _mm512_set_epi64(11, 10, 9, 8, 3, 2, 1, 0);
+    const __m512i half_hi = _mm512_set_epi64(15, 14, 13, 12, 7, 6, 5, 4);
+    __m512i words[lanes];
+    for (size_t i = 0; i < lanes / 2; ++i)
+    {
+        /* quads[i] holds words (i/2 + (i%2)*2) and +4 of keys 0-3 */
+        const size_t word = i / 2 + (i % 2) * 2;
+        words[word]     = _mm512_permutex2var_epi64(
+                                    quads[i], half_lo, quads[i + 4]);
+        words[word + 4] = _mm512_permutex2var_epi64(
+                                    quads[i], half_hi, quads[i + 4]);
+    }
+
+    const __m512i mult_vec = _mm512_set1_epi64((long long) mult);
+    __m512i hash = _mm512_xor_si512(
+                        _mm512_set1_epi64((long long) seed),
+                        _mm512_mullo_epi64(width, mult_vec));
+
+    for (size_t i = 0; i < len / sizeof(uint64_t); ++i)
+    {
+        /* Lanes, whose keys are narrower, keep their hashes */
+        const __mmask8 active = _mm512_cmpgt_epu64_mask(
+                        width, _mm512_set1_epi64((long long) (i * 8)));
+
+        __m512i cur_sym = _mm512_mullo_epi64(words[i], mult_vec);
+        cur_sym = _mm512_xor_si512(cur_sym,
+                            _mm512_maskz_srli_epi64(all_lanes, cur_sym, 47));
+        cur_sym = _mm512_mullo_epi64(cur_sym, mult_vec);
+
+        hash = _mm512_mask_xor_epi64(hash, active, hash, cur_sym);
+        hash = _mm512_mask_mullo_epi64(hash, active, hash, mult_vec);
+    }
+
+    _mm512_storeu_si512(hashes, hash);
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static void hash_murmur_batch_impl(const char* const* keys,
+                                   const uint32_t* widths, size_t key_count,
+                                   uint64_t* hashes)
+{
+    const size_t lanes = 8;
+    size_t i = 0;
+
+    for (; i + lanes <= key_count; i += lanes)
+    {
+        int has_null = 0;
+        for (size_t j = 0; j < lanes; ++j)
+            has_null |= keys[i + j] == NULL;
+
+        if (!has_null)
+        {
+            hash_murmur_x8(keys + i, widths ? widths + i : NULL, hashes + i);
+            continue;
+        }
+
+        for (size_t j = 0; j < lanes; ++j)
+            if (keys[i + j])
+                hashes[i + j] = hash_murmur_one(keys[i + j],
+                                                widths ? widths + i + j
+                                                       : NULL);
+    }
+
+    for (; i < key_count; ++i)
+        if (keys[i])
+            hashes[i] = hash_murmur_one(keys[i], widths ? widths + i : NULL);
+}
+
+__attribute__((target("default")))
+static void hash_murmur_batch_impl(const char* const* keys,
+                                   const uint32_t* widths, size_t key_count,
+                                   uint64_t* hashes)
+{
+    for (size_t i = 0; i < key_count; ++i)
+        if (keys[i])
+            hashes[i] = hash_murmur_one(keys[i], widths ? widths + i : NULL);
+}
+
+void hash_murmur_batch(const char* const* keys, size_t key_count,
+                       uint64_t* hashes)
+{
+    /* Version for current CPU is selected when program is loaded */
+    hash_murmur_batch_impl(keys, NULL, key_count, hashes);
+}
+
+void hash_murmur_prefix_batch(const char* const* keys,
+                              const uint32_t* widths, size_t key_count,
+                              uint64_t* hashes)
+{
+    hash_murmur_batch_impl(keys, widths, key_count, hashes);
+}
+
+struct NamedHashFunction
+{
+    const char* name;
+    uint64_t (*function)(const char*);
+};
+
+static const NamedHashFunction runtime_hash_functions[] = {
+    {"hash_always_one", hash_always_one},
+    {"hash_first_char", hash_first_char},
+    {"hash_strlen",     hash_strlen    },
+    {"hash_sum_char",   hash_sum_char  },
+    {"hash_ror_xor",    hash_ror_xor   },
+    {"hash_rol_xor",    hash_rol_xor   },
+    {"hash_murmur",     hash_murmur    },
+    {"hash_crc32c",     hash_crc32c    },
+};
+
+static uint64_t (*runtime_hash_function)(const char*) = hash_murmur;
+
+uint64_t hash_runtime(const char* str)
+{
+    return runtime_hash_function(str);
+}
+
+int hash_runtime_select(const char* name)
+{
+    if constexpr (HASH_FUNCTION != hash_runtime)
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    const size_t function_count = sizeof(runtime_hash_functions)
+                                / sizeof(*runtime_hash_functions);
+
+    for (size_t i = 0; i < function_count; ++i)
+        if (strcmp(runtime_hash_functions[i].name, name) == 0)
+        {
+            runtime_hash_function = runtime_hash_functions[i].function;
+            return 0;
+        }
+
+    errno = EINVAL;
+    return -1;
+}
@@ -13,6 +13,7 @@
 #define __HASH_FUNCTIONS_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 uint64_t hash_always_one(const char* str);
 
@@ -26,6 +27,12 @@ uint64_t hash_ror_xor   (const char* str);
 
 uint64_t hash_rol_xor   (const char* str);
 
+/**
+ * @brief CRC32C of 64-byte key, computed in two independent streams
+ * with SSE4.2 `crc32` instruction (or lookup table on older CPUs)
+ */
+uint64_t hash_crc32c    (const char* str);
+
 inline uint64_t __attribute__((always_inline)) hash_murmur(const char* str)
 {
     /*
@@ -74,5 +81,78 @@ inline uint64_t __attribute__((always_inline)) hash_murmur(const char* str)
     return hash;
 }
 
+/**
+ * @brief Compute `hash_murmur` of first `KeyWidth` bytes of key. For keys,
+ * which are zero past `KeyWidth` bytes, it skips hashing zero tail.
+ * `hash_murmur_prefix<64>` is the same as `hash_murmur`
+ */
+template <size_t KeyWidth>
+inline uint64_t __attribute__((always_inline))
+hash_murmur_prefix(const char* str)
+{
+    static_assert(KeyWidth % sizeof(uint64_t) == 0 && KeyWidth <= 64,
+                  "Key width must be a multiple of 8 not exceeding 64");
+
+    const uint64_t mult = 0xC6A4A7935BD1E995;
+    const uint64_t seed = 0x8B72E9FB7FAA60FD;
+    const uint64_t* data = (const uint64_t *)str;
+
+    uint64_t hash = seed ^ (KeyWidth * mult);
+
+    for (size_t i = 0; i < KeyWidth / sizeof(uint64_t); ++i)
+    {
+        uint64_t cur_sym = data[i] * mult;
+        cur_sym ^= cur_sym >> 47;
+        cur_sym *= mult;
+
+        hash ^= cur_sym;
+        hash *= mult;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Compute `hash_murmur` of array of keys. On CPUs with AVX-512
+ * 8 keys are hashed at once. Hashes of NULL keys are left unchanged
+ *
+ * @param[in] keys	- Array of keys, 64 bytes each
+ * @param[in] key_count	- Number of keys
+ * @param[out] hashes	- Array of hashes
+ */
+void hash_murmur_batch(const char* const* keys, size_t key_count,
+                       uint64_t* hashes);
+
+/**
+ * @brief Compute `hash_murmur_prefix` of array of keys, each with its own
+ * width. On CPUs with AVX-512 8 keys are hashed at once, whatever their
+ * widths are. Hashes of NULL keys are left unchanged
+ *
+ * @param[in] keys	- Array of keys, 64 bytes each
+ * @param[in] widths	- Array of key widths, multiples of 8 not exceeding 64
+ * @param[in] key_count	- Number of keys
+ * @param[out] hashes	- Array of hashes
+ */
+void hash_murmur_prefix_batch(const char* const* keys,
+                              const uint32_t* widths, size_t key_count,
+                              uint64_t* hashes);
+
+/**
+ * @brief Call hash function, selected with `hash_runtime_select`
+ * (`hash_murmur` by default)
+ */
+uint64_t hash_runtime   (const char* str);
+
+/**
+ * @brief Select hash function, called by `hash_runtime`
+ *
+ * @param[in] name	- Name of hash function (e.g. "hash_crc32c")
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - there is no hash function with such name
+ * @exception ENOTSUP   - hash table does not use `hash_runtime`
+ */
+int hash_runtime_select(const char* name);
 
 #endif /* hash_functions.h */
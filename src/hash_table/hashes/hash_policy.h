@@ -0,0 +1,127 @@
+/**
+ * @file hash_policy.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ * 
+ * @brief Compile-time selection of hash function used by hash table
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HASH_TABLE_HASHES_HASH_POLICY_H
+#define __HASH_TABLE_HASHES_HASH_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_functions.h"
+
+/**
+ * @brief Hash of key, which is zero past its first `KeyWidth` bytes.
+ * Generic hash function always reads whole key
+ */
+template <uint64_t (*hash_function)(const char*), size_t KeyWidth>
+struct PrefixHash
+{
+    static __always_inline uint64_t hash(const char* key)
+    {
+        return hash_function(key);
+    }
+};
+
+/* Murmur hash skips zero tail of short keys */
+template <size_t KeyWidth>
+struct PrefixHash<hash_murmur, KeyWidth>
+{
+    static __always_inline uint64_t hash(const char* key)
+    {
+        return hash_murmur_prefix<KeyWidth>(key);
+    }
+};
+
+/**
+ * @brief Hashing policy, built around hash function known at compile
+ * time. Hash function is called directly and can be inlined
+ */
+template <uint64_t (*hash_function)(const char*)>
+struct HashPolicy
+{
+    /**
+     * @brief Hash single key
+     */
+    static __always_inline uint64_t hash(const char* key)
+    {
+        return hash_function(key);
+    }
+
+    /**
+     * @brief Hash key, which is zero past its first `KeyWidth` bytes.
+     * Equal keys have equal hashes only if they are hashed with the same
+     * `KeyWidth`
+     */
+    template <size_t KeyWidth>
+    static __always_inline uint64_t hash_prefix(const char* key)
+    {
+        return PrefixHash<hash_function, KeyWidth>::hash(key);
+    }
+
+    /**
+     * @brief Hash array of keys. Hashes of NULL keys are left unchanged
+     */
+    static __always_inline void hash_batch(const char* const* keys,
+                                           size_t key_count,
+                                           uint64_t* hashes)
+    {
+        for (size_t i = 0; i < key_count; ++i)
+            if (keys[i])
+                hashes[i] = hash_function(keys[i]);
+    }
+
+    /**
+     * @brief Hash array of keys, i-th of which is zero past its first
+     * `widths[i]` bytes, the same way as `hash_prefix` does. Hashes of NULL
+     * keys are left unchanged
+     */
+    static __always_inline void hash_prefix_batch(const char* const* keys,
+                                                  const uint32_t* widths,
+                                                  size_t key_count,
+                                                  uint64_t* hashes)
+    {
+        /* Generic prefix hash reads whole key */
+        (void) widths;
+        hash_batch(keys, key_count, hashes);
+    }
+};
+
+/* Murmur hash has vectorized kernel for arrays of keys */
+template <>
+__always_inline void HashPolicy<hash_murmur>::hash_batch(
+                                            const char* const* keys,
+                                            size_t key_count,
+                                            uint64_t* hashes)
+{
+    hash_murmur_batch(keys, key_count, hashes);
+}
+
+template <>
+__always_inline void HashPolicy<hash_murmur>::hash_prefix_batch(
+                                            const char* const* keys,
+                                            const uint32_t* widths,
+                                            size_t key_count,
+                                            uint64_t* hashes)
+{
+    hash_murmur_prefix_batch(keys, widths, key_count, hashes);
+}
+
+/*
+ * Hash function used by hash table, selected with HASH_FUNC make variable.
+ * Build with HASH_FUNC=hash_runtime to choose it at run time instead
+ */
+#ifndef HASH_FUNCTION
+#define HASH_FUNCTION hash_murmur
+#endif
+
+typedef HashPolicy<HASH_FUNCTION> TableHashPolicy;
+
+#endif /* hash_policy.h */
@@ -0,0 +1,34 @@
+#include <stddef.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "key_kernels.h"
+
+/*
+ * Key is padded once per table operation, so it is not worth inlining into
+ * versions of probe loops. GCC selects version of kernel through ifunc
+ * resolver, when program is loaded.
+ */
+
+__attribute__((target("avx512f,avx512bw")))
+static void load_padded_key_impl(char* padded, const char* key, size_t length)
+{
+    /* Masked-out bytes are not accessed, so load cannot fault past the end
+     * of key */
+    const __mmask64 mask = length < key_kernel_width
+                         ? (1ull << length) - 1
+                         : ~0ull;
+    _mm512_store_si512(padded, _mm512_maskz_loadu_epi8(mask, key));
+}
+
+__attribute__((target("default")))
+static void load_padded_key_impl(char* padded, const char* key, size_t length)
+{
+    memcpy(padded, key, length);
+    memset(padded + length, 0, key_kernel_width - length);
+}
+
+void load_padded_key(char* padded, const char* key, size_t length)
+{
+    load_padded_key_impl(padded, key, length);
+}
@@ -0,0 +1,207 @@
+/**
+ * @file key_kernels.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief SIMD kernels for comparing and padding keys and scanning
+ * control bytes. Probe loops are instantiated for every kernel set
+ * (AVX-512, AVX2 or SSE2), and version for current CPU is selected once
+ * per call of probe loop
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HASH_TABLE_KEY_KERNELS_H
+#define __HASH_TABLE_KEY_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+/**
+ * @brief Number of bytes processed by kernels
+ */
+static constexpr size_t key_kernel_width = 64;
+
+/*
+ * Every kernel set provides:
+ *
+ * `int keys_equal(const char* lhs, const char* rhs)` - compare two keys,
+ * padded with zeros to `key_kernel_width` bytes and aligned to it. Returns
+ * 1 if keys are equal, 0 otherwise
+ *
+ * `uint64_t bytes_match(const uint8_t* bytes, uint8_t value)` - find bytes
+ * equal to given value in aligned array of `key_kernel_width` bytes.
+ * Returns bitmask with i-th bit set if i-th byte is equal to `value`
+ *
+ * `uint64_t bytes_high_bit(const uint8_t* bytes)` - find bytes with
+ * highest bit set in aligned array of `key_kernel_width` bytes. Returns
+ * bitmask with i-th bit set if highest bit of i-th byte is set
+ *
+ * Kernels are compiled for their instruction set, so they are inlined only
+ * into functions compiled for it (see `KEY_KERNELS_DISPATCH`)
+ */
+
+struct KeyKernelsAvx512
+{
+    __attribute__((target("avx512f,avx512bw")))
+    static inline int keys_equal(const char* lhs, const char* rhs)
+    {
+        __m512i lhs_vec = _mm512_load_si512(lhs);
+        __m512i rhs_vec = _mm512_load_si512(rhs);
+        return !~_mm512_cmpeq_epi8_mask(lhs_vec, rhs_vec);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static inline uint64_t bytes_match(const uint8_t* bytes, uint8_t value)
+    {
+        __m512i vec = _mm512_load_si512(bytes);
+        return _mm512_cmpeq_epi8_mask(vec, _mm512_set1_epi8((char) value));
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static inline uint64_t bytes_high_bit(const uint8_t* bytes)
+    {
+        return _mm512_movepi8_mask(_mm512_load_si512(bytes));
+    }
+};
+
+struct KeyKernelsAvx2
+{
+    __attribute__((target("avx2")))
+    static inline int keys_equal(const char* lhs, const char* rhs)
+    {
+        const __m256i* lhs_vec = (const __m256i*) lhs;
+        const __m256i* rhs_vec = (const __m256i*) rhs;
+
+        __m256i cmp_lo = _mm256_cmpeq_epi8(_mm256_load_si256(lhs_vec),
+                                           _mm256_load_si256(rhs_vec));
+        __m256i cmp_hi = _mm256_cmpeq_epi8(_mm256_load_si256(lhs_vec + 1),
+                                           _mm256_load_si256(rhs_vec + 1));
+
+        return _mm256_movemask_epi8(_mm256_and_si256(cmp_lo, cmp_hi)) == -1;
+    }
+
+    __attribute__((target("avx2")))
+    static inline uint64_t bytes_match(const uint8_t* bytes, uint8_t value)
+    {
+        const __m256i* vec = (const __m256i*) bytes;
+        const __m256i pattern = _mm256_set1_epi8((char) value);
+
+        uint64_t mask_lo = (uint32_t) _mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(_mm256_load_si256(vec), pattern));
+        uint64_t mask_hi = (uint32_t) _mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(_mm256_load_si256(vec + 1),
+                                          pattern));
+
+        return mask_lo | (mask_hi << 32);
+    }
+
+    __attribute__((target("avx2")))
+    static inline uint64_t bytes_high_bit(const uint8_t* bytes)
+    {
+        const __m256i* vec = (const __m256i*) bytes;
+
+        uint64_t mask_lo = (uint32_t) _mm256_movemask_epi8(
+                                                _mm256_load_si256(vec));
+        uint64_t mask_hi = (uint32_t) _mm256_movemask_epi8(
+                                                _mm256_load_si256(vec + 1));
+
+        return mask_lo | (mask_hi << 32);
+    }
+};
+
+struct KeyKernelsSse2
+{
+    static inline int keys_equal(const char* lhs, const char* rhs)
+    {
+        const __m128i* lhs_vec = (const __m128i*) lhs;
+        const __m128i* rhs_vec = (const __m128i*) rhs;
+
+        __m128i cmp = _mm_set1_epi8(-1);
+        for (size_t i = 0; i < key_kernel_width / sizeof(__m128i); ++i)
+            cmp = _mm_and_si128(cmp,
+                                _mm_cmpeq_epi8(_mm_load_si128(lhs_vec + i),
+                                               _mm_load_si128(rhs_vec + i)));
+
+        return _mm_movemask_epi8(cmp) == 0xFFFF;
+    }
+
+    static inline uint64_t bytes_match(const uint8_t* bytes, uint8_t value)
+    {
+        const __m128i* vec = (const __m128i*) bytes;
+        const __m128i pattern = _mm_set1_epi8((char) value);
+
+        uint64_t mask = 0;
+        for (size_t i = 0; i < key_kernel_width / sizeof(__m128i); ++i)
+        {
+            const uint64_t part = (uint16_t) _mm_movemask_epi8(
+                            _mm_cmpeq_epi8(_mm_load_si128(vec + i), pattern));
+            mask |= part << (i * sizeof(__m128i));
+        }
+
+        return mask;
+    }
+
+    static inline uint64_t bytes_high_bit(const uint8_t* bytes)
+    {
+        const __m128i* vec = (const __m128i*) bytes;
+
+        uint64_t mask = 0;
+        for (size_t i = 0; i < key_kernel_width / sizeof(__m128i); ++i)
+        {
+            const uint64_t part = (uint16_t) _mm_movemask_epi8(
+                                                _mm_load_si128(vec + i));
+            mask |= part << (i * sizeof(__m128i));
+        }
+
+        return mask;
+    }
+};
+
+/*
+ * Define static function `name`, which calls `name##_impl<Kernels>` with
+ * kernel set for current CPU. Version for every kernel set is compiled
+ * with kernels and all callees inlined into it, and GCC selects one of
+ * them through ifunc resolver, when program is loaded. `params` and `args`
+ * are parenthesized parameter and argument lists of `name`
+ */
+#define KEY_KERNELS_DISPATCH(return_type, name, params, args)               \
+    __attribute__((target("avx512f,avx512bw"), flatten))                   \
+    static return_type name##_dispatch params                              \
+    {                                                                       \
+        return name##_impl<KeyKernelsAvx512> args;                          \
+    }                                                                       \
+                                                                            \
+    __attribute__((target("avx2"), flatten))                               \
+    static return_type name##_dispatch params                              \
+    {                                                                       \
+        return name##_impl<KeyKernelsAvx2> args;                            \
+    }                                                                       \
+                                                                            \
+    __attribute__((target("default"), flatten))                            \
+    static return_type name##_dispatch params                              \
+    {                                                                       \
+        return name##_impl<KeyKernelsSse2> args;                            \
+    }                                                                       \
+                                                                            \
+    static return_type name params                                         \
+    {                                                                       \
+        return name##_dispatch args;                                        \
+    }
+
+/**
+ * @brief Copy key of arbitrary length and alignment into padded key
+ * buffer. No bytes past the end of key are read. Best implementation for
+ * current CPU is selected once at program startup
+ *
+ * @param[out] padded	- Buffer of `key_kernel_width` bytes, aligned to
+ *                        `key_kernel_width`. It is filled with key and
+ *                        padded with zeros
+ * @param[in]  key	- Key bytes
+ * @param[in]  length	- Key length, not exceeding `key_kernel_width`
+ */
+void load_padded_key(char* padded, const char* key, size_t length);
+
+#endif /* key_kernels.h */
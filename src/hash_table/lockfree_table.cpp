@@ -0,0 +1,529 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "hashes/hash_policy.h"
+
+#include "lockfree_table.h"
+#include "key_kernels.h"
+
+/* Slot arrays stop accepting keys, when this share of slots is claimed */
+static const size_t slots_max_load_numerator   = 3;
+static const size_t slots_max_load_denominator = 4;
+
+/* Each next slot array is this many times larger than previous one, so
+ * that probes of late keys pass few filled arrays */
+static const size_t slots_growth_factor = 4;
+
+static const size_t slots_min_capacity = 1 << 10;
+
+/* Number of keys, which are hashed together */
+static const size_t batch_chunk_size = 64;
+
+static const uint64_t tag_empty = 0;
+static const uint64_t tag_moved = 1;
+static const uint64_t tag_ready = 1;
+
+static LockFreeSlots* allocate_slots(size_t capacity);
+static LockFreeSlots* get_next_slots(LockFreeSlots* slots);
+static LockFreeSlot* find_slot(const LockFreeHashTable* table,
+                               const char* key, uint64_t key_hash);
+static int increment_counter(LockFreeHashTable* table,
+                             const char* key, uint64_t key_hash);
+static void add_count(LockFreeSlot* slot, size_t amount);
+static size_t get_count(const LockFreeSlot* slot);
+
+/**
+ * @brief Get tag of claimed slot for key hash. Tag never equals
+ * `tag_empty` or `tag_moved` and has ready bit cleared
+ */
+__always_inline
+static uint64_t get_tag(uint64_t key_hash)
+{
+    return (key_hash | 2) & ~tag_ready;
+}
+
+/**
+ * @brief Wait until key of claimed slot is published
+ *
+ * @return Tag with ready bit set
+ */
+__always_inline
+static uint64_t wait_ready(const uint64_t* tag)
+{
+    uint64_t value = __atomic_load_n(tag, __ATOMIC_ACQUIRE);
+    while (!(value & tag_ready))
+    {
+        /* Writer may have been preempted between claim and publication */
+        sched_yield();
+        value = __atomic_load_n(tag, __ATOMIC_ACQUIRE);
+    }
+
+    return value;
+}
+
+__always_inline
+static size_t round_to_pow2(size_t x)
+{
+    size_t result = 1;
+    while (result < x)
+        result <<= 1;
+    return result;
+}
+
+int lockfree_table_ctor(LockFreeHashTable* table, size_t expected_distinct)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    size_t capacity = round_to_pow2(expected_distinct
+                                    * slots_max_load_denominator
+                                    / slots_max_load_numerator + 1);
+    if (capacity < slots_min_capacity)
+        capacity = slots_min_capacity;
+
+    table->first = allocate_slots(capacity);
+    if (!table->first)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+int lockfree_table_dtor(LockFreeHashTable* table)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    LockFreeSlots* slots = table->first;
+    while (slots)
+    {
+        for (size_t i = 0; i <= slots->mask; ++i)
+            if (slots->tags[i] & ~tag_moved)
+                free(slots->slots[i].stripes);
+
+        LockFreeSlots* next = slots->next;
+        free(slots);
+        slots = next;
+    }
+
+    table->first = NULL;
+
+    return 0;
+}
+
+int lockfree_table_key_increment_counter(LockFreeHashTable* table,
+                                         const char* key)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(key   != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return increment_counter(table, key, TableHashPolicy::hash(key));
+}
+
+int lockfree_table_key_increment_counter_batch(LockFreeHashTable* table,
+                                               const char* const* keys,
+                                               size_t key_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(keys  != NULL || key_count == 0);
+        for (size_t i = 0; i < key_count; ++i)
+            ASSERT_TRUE(keys[i] != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    uint64_t hashes[batch_chunk_size] = {};
+
+    for (size_t start = 0; start < key_count; start += batch_chunk_size)
+    {
+        const size_t chunk = key_count - start < batch_chunk_size
+                                ? key_count - start
+                                : batch_chunk_size;
+
+        TableHashPolicy::hash_batch(keys + start, chunk, hashes);
+
+        for (size_t i = 0; i < chunk; ++i)
+            if (increment_counter(table, keys[start + i], hashes[i]) < 0)
+                return -1;
+    }
+
+    return 0;
+}
+
+size_t lockfree_table_get_key_count(const LockFreeHashTable* table,
+                                    const char* key)
+{
+    if (!table || !key)
+        return 0;
+
+    const LockFreeSlot* slot = find_slot(table, key,
+                                         TableHashPolicy::hash(key));
+
+    return slot ? get_count(slot) : 0;
+}
+
+size_t lockfree_table_get_distinct_count(const LockFreeHashTable* table)
+{
+    if (!table)
+        return 0;
+
+    size_t distinct_count = 0;
+    for (const LockFreeSlots* slots = table->first; slots;
+         slots = slots->next)
+        distinct_count += slots->distinct_count;
+
+    return distinct_count;
+}
+
+int lockfree_table_export(const LockFreeHashTable* table, HashTable* target)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table  != NULL);
+        ASSERT_TRUE(target != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    /* Reservation failures are not fatal: table grows instead */
+    hash_table_reserve(target, target->distinct_count +
+                               lockfree_table_get_distinct_count(table));
+
+    for (const LockFreeSlots* slots = table->first; slots;
+         slots = slots->next)
+    {
+        for (size_t i = 0; i <= slots->mask; ++i)
+        {
+            if (!(slots->tags[i] & ~tag_moved))
+                continue;
+
+            const LockFreeSlot* slot = &slots->slots[i];
+            if (hash_table_key_increase_counter_n(target, slot->key,
+                                                  strnlen(slot->key,
+                                                          max_word_length),
+                                                  get_count(slot)) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate slot array with empty tags. Header, tags and slots are
+ * allocated together
+ *
+ * @return Allocated array, NULL upon error
+ */
+static LockFreeSlots* allocate_slots(size_t capacity)
+{
+    const size_t tags_size = capacity * sizeof(uint64_t);
+    LockFreeSlots* slots = (LockFreeSlots*) aligned_alloc(
+                                alignof(LockFreeSlot),
+                                sizeof(*slots) + tags_size
+                                + capacity * sizeof(LockFreeSlot));
+    if (!slots)
+        return NULL;
+
+    /* Slots are written by the thread, which claims them, before they
+     * are published, so only tags need to be cleared */
+    memset(slots, 0, sizeof(*slots) + tags_size);
+
+    slots->mask  = capacity - 1;
+    slots->limit = capacity / slots_max_load_denominator
+                            * slots_max_load_numerator;
+    slots->tags  = (uint64_t*) (slots + 1);
+    slots->slots = (LockFreeSlot*) ((char*) slots->tags + tags_size);
+
+    return slots;
+}
+
+/**
+ * @brief Get next slot array, allocating it, if no thread has done it yet
+ *
+ * @return Next array, NULL upon error
+ */
+static LockFreeSlots* get_next_slots(LockFreeSlots* slots)
+{
+    LockFreeSlots* next = __atomic_load_n(&slots->next, __ATOMIC_ACQUIRE);
+    if (next)
+        return next;
+
+    LockFreeSlots* allocated = allocate_slots(slots_growth_factor
+                                              * (slots->mask + 1));
+    if (!allocated)
+        return NULL;
+
+    if (__atomic_compare_exchange_n(&slots->next, &next, allocated, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return allocated;
+
+    /* Other thread has published its array first */
+    free(allocated);
+    return next;
+}
+
+/**
+ * @brief Find published slot of key. Key is searched in the following
+ * array only if its probe in current one reaches moved slot
+ *
+ * @return Found slot, NULL if key is not present
+ */
+template <class Kernels>
+static LockFreeSlot* find_slot_impl(const LockFreeHashTable* table,
+                                    const char* key, uint64_t key_hash)
+{
+    const uint64_t tag = get_tag(key_hash);
+    LockFreeSlots* slots = table->first;
+
+    while (slots)
+    {
+        size_t index = key_hash & slots->mask;
+
+        while (1)
+        {
+            uint64_t current = __atomic_load_n(&slots->tags[index],
+                                               __ATOMIC_ACQUIRE);
+            if (current == tag_empty)
+                return NULL;
+
+            if (current == tag_moved)
+                break;
+
+            if ((current & ~tag_ready) == tag)
+            {
+                wait_ready(&slots->tags[index]);
+                if (Kernels::keys_equal(slots->slots[index].key, key))
+                    return &slots->slots[index];
+            }
+
+            index = (index + 1) & slots->mask;
+        }
+
+        slots = __atomic_load_n(&slots->next, __ATOMIC_ACQUIRE);
+    }
+
+    return NULL;
+}
+
+KEY_KERNELS_DISPATCH(LockFreeSlot*, find_slot,
+                     (const LockFreeHashTable* table,
+                      const char* key, uint64_t key_hash),
+                     (table, key, key_hash))
+
+/**
+ * @brief Claim empty slot for key or mark it as moved, if slot array
+ * is full
+ *
+ * @param[out] current	- Tag of slot after the attempt
+ *
+ * @return 1 if slot was claimed for key, 0 otherwise
+ */
+__always_inline
+static int claim_slot(LockFreeSlots* slots, size_t index, uint64_t tag,
+                      uint64_t* current)
+{
+    const int has_room = __atomic_fetch_add(&slots->claimed, 1,
+                                            __ATOMIC_RELAXED)
+                         < slots->limit;
+    const uint64_t desired = has_room ? tag : tag_moved;
+
+    *current = tag_empty;
+    if (__atomic_compare_exchange_n(&slots->tags[index], current, desired,
+                                    false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE))
+    {
+        *current = desired;
+        return has_room;
+    }
+
+    /* Slot was taken by other thread, return reserved room */
+    if (has_room)
+        __atomic_fetch_sub(&slots->claimed, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/**
+ * @brief Increment counter of key with precomputed hash, inserting key,
+ * if it is absent. Never blocks: threads, which insert the same key, race
+ * for the same empty slot, and losers count the key in winner's slot
+ */
+template <class Kernels>
+static int increment_counter_impl(LockFreeHashTable* table,
+                                  const char* key, uint64_t key_hash)
+{
+    const uint64_t tag = get_tag(key_hash);
+    LockFreeSlots* slots = table->first;
+
+    while (1)
+    {
+        size_t index = key_hash & slots->mask;
+
+        while (1)
+        {
+            uint64_t current = __atomic_load_n(&slots->tags[index],
+                                               __ATOMIC_ACQUIRE);
+            if (current == tag_empty &&
+                claim_slot(slots, index, tag, &current))
+            {
+                LockFreeSlot* slot = &slots->slots[index];
+                memcpy(slot->key, key, sizeof(slot->key));
+                slot->count = 1;
+                slot->stripes = NULL;
+
+                /* Key is written before it becomes visible to readers */
+                __atomic_store_n(&slots->tags[index], tag | tag_ready,
+                                 __ATOMIC_RELEASE);
+                __atomic_fetch_add(&slots->distinct_count, 1,
+                                   __ATOMIC_RELAXED);
+                return 0;
+            }
+
+            if (current == tag_moved)
+                break;
+
+            if ((current & ~tag_ready) == tag)
+            {
+                wait_ready(&slots->tags[index]);
+                if (Kernels::keys_equal(slots->slots[index].key, key))
+                {
+                    add_count(&slots->slots[index], 1);
+                    return 0;
+                }
+            }
+
+            index = (index + 1) & slots->mask;
+        }
+
+        slots = get_next_slots(slots);
+        if (!slots)
+        {
+            // TODO: Logs
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+}
+
+KEY_KERNELS_DISPATCH(int, increment_counter,
+                     (LockFreeHashTable* table,
+                      const char* key, uint64_t key_hash),
+                     (table, key, key_hash))
+
+/**
+ * @brief Get stripe of calling thread. Threads are given stripes in
+ * order of their first increment of hot key
+ */
+__always_inline
+static size_t get_stripe_index(void)
+{
+    static size_t next_stripe = 0;
+    static thread_local size_t stripe = SIZE_MAX;
+
+    if (stripe == SIZE_MAX)
+        stripe = __atomic_fetch_add(&next_stripe, 1, __ATOMIC_RELAXED)
+                 & (lockfree_table_stripe_count - 1);
+
+    return stripe;
+}
+
+/**
+ * @brief Add amount to counter of published slot. Counter of hot key is
+ * striped, when it reaches `lockfree_table_hot_count`
+ */
+static void add_count(LockFreeSlot* slot, size_t amount)
+{
+    LockFreeStripe* stripes = __atomic_load_n(&slot->stripes,
+                                              __ATOMIC_ACQUIRE);
+    if (stripes)
+    {
+        __atomic_fetch_add(&stripes[get_stripe_index()].count, amount,
+                           __ATOMIC_RELAXED);
+        return;
+    }
+
+    const size_t old_count = __atomic_fetch_add(&slot->count, amount,
+                                                __ATOMIC_RELAXED);
+
+    /* Only one thread crosses the threshold, so stripes are published
+     * once. If allocation fails, key keeps using shared counter */
+    if (old_count < lockfree_table_hot_count &&
+        old_count + amount >= lockfree_table_hot_count)
+    {
+        stripes = (LockFreeStripe*) aligned_alloc(
+                                        alignof(LockFreeStripe),
+                                        lockfree_table_stripe_count
+                                        * sizeof(LockFreeStripe));
+        if (!stripes)
+            return;
+
+        memset(stripes, 0, lockfree_table_stripe_count * sizeof(*stripes));
+        __atomic_store_n(&slot->stripes, stripes, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Get total count of published slot
+ */
+static size_t get_count(const LockFreeSlot* slot)
+{
+    size_t count = __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+
+    const LockFreeStripe* stripes = __atomic_load_n(&slot->stripes,
+                                                    __ATOMIC_ACQUIRE);
+    if (stripes)
+    {
+        for (size_t i = 0; i < lockfree_table_stripe_count; ++i)
+            count += __atomic_load_n(&stripes[i].count, __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file lockfree_table.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Word-count table, updated by several threads without locks
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HASH_TABLE_LOCKFREE_TABLE_H
+#define __HASH_TABLE_LOCKFREE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+
+/* Number of per-thread counters of hot key. Power of two */
+static constexpr size_t lockfree_table_stripe_count = 16;
+static_assert((lockfree_table_stripe_count &
+               (lockfree_table_stripe_count - 1)) == 0,
+              "Stripe count must be a power of two");
+
+/* Key becomes hot, when its shared counter reaches this value */
+static constexpr size_t lockfree_table_hot_count = 1 << 12;
+
+/*
+ * Counter of hot key, owned by a group of threads. Stripes are kept in
+ * separate cache lines, so that threads do not contend for them
+ */
+struct LockFreeStripe
+{
+    size_t count;
+} __attribute__((aligned (64)));
+
+/*
+ * Key and counters of claimed slot. Increments go to `count` until it
+ * reaches `lockfree_table_hot_count`, after which thread, that reached it,
+ * publishes `stripes`, and all further increments are spread between them
+ */
+struct LockFreeSlot
+{
+    char key[max_word_length] __attribute__((aligned (max_word_length)));
+    size_t count;
+    LockFreeStripe* stripes;
+};
+
+/*
+ * Open-addressing array of slots. Slot is claimed by compare-and-swap of
+ * its tag from zero to value, derived from key hash. Key is then written
+ * and published by setting ready bit of tag with release semantics. Tags
+ * are kept apart from slots, so that probes read several tags at once.
+ *
+ * When `claimed` reaches `limit`, empty slots are no longer claimed for
+ * keys. Instead, they are marked as moved, and keys, whose probes reach
+ * moved slot, are searched and inserted in larger `next` array. Slots are
+ * never emptied, so no key is ever present in two arrays
+ */
+struct LockFreeSlots
+{
+    size_t mask;
+    size_t limit;
+    size_t claimed;
+    size_t distinct_count;
+
+    LockFreeSlots* next;
+    uint64_t* tags;
+    LockFreeSlot* slots;
+} __attribute__((aligned (64)));
+
+struct LockFreeHashTable
+{
+    LockFreeSlots* first;
+};
+
+/**
+ * @brief Create and initialize new lock-free table
+ *
+ * @param[out] table		    - Table instance to be initialized
+ * @param[in]  expected_distinct    - Expected number of distinct keys
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL
+ * @exception ENOMEM    - failed to allocate memory for table
+ */
+int lockfree_table_ctor(LockFreeHashTable* table, size_t expected_distinct);
+
+/**
+ * @brief Destroy lock-free table. Must not be called concurrently with
+ * any other operation
+ *
+ * @param[inout] table	- Table to be deinitialized
+ *
+ * @return 0 upon success, -1 upon invalid parameter
+ */
+int lockfree_table_dtor(LockFreeHashTable* table);
+
+/**
+ * @brief Increment counter on entry associated with given key. May be
+ * called by several threads at once
+ *
+ * @param[in] key	- Counted key, padded with zeros to
+ *                        `max_word_length` bytes and aligned
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or key is NULL
+ * @exception ENOMEM    - failed to allocate memory for slots
+ */
+int lockfree_table_key_increment_counter(LockFreeHashTable* table,
+                                         const char* key);
+
+/**
+ * @brief Increment counters on entries associated with each of given keys.
+ * May be called by several threads at once
+ *
+ * @param[in] keys	    - Array of padded and aligned keys
+ * @param[in] key_count	    - Number of keys in array
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table, keys or one of keys is NULL
+ * @exception ENOMEM    - failed to allocate memory for slots
+ */
+int lockfree_table_key_increment_counter_batch(LockFreeHashTable* table,
+                                               const char* const* keys,
+                                               size_t key_count);
+
+/**
+ * @brief Get value of counter on entry associated with given key. May be
+ * called concurrently with increments, which are then either fully counted
+ * or not counted at all
+ *
+ * @param[in] key	- Padded and aligned key
+ *
+ * @return Counter value
+ */
+size_t lockfree_table_get_key_count(const LockFreeHashTable* table,
+                                    const char* key);
+
+/**
+ * @brief Get number of distinct keys in table. Must not be called
+ * concurrently with increments
+ *
+ * @return Number of distinct keys
+ */
+size_t lockfree_table_get_distinct_count(const LockFreeHashTable* table);
+
+/**
+ * @brief Add counts of all keys to regular hash table. Must not be called
+ * concurrently with increments
+ *
+ * @param[in]    table	    - Source table
+ * @param[inout] target	    - Table to add counts to
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or target is NULL
+ * @exception ENOMEM    - failed to allocate memory for entry in target
+ */
+int lockfree_table_export(const LockFreeHashTable* table, HashTable* target);
+
+#endif /* lockfree_table.h */
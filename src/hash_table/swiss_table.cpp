@@ -0,0 +1,964 @@
+#ifdef HASH_TABLE_SWISS
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "hashes/hash_policy.h"
+
+#include "hash_table.h"
+#include "key_kernels.h"
+
+static const double highest_load_factor = 0.875;
+
+/* Number of keys, which are hashed and prefetched together */
+static const size_t batch_group_size = 16;
+
+static int allocate_slots(HashTable* table, size_t group_count);
+static int try_grow(HashTable* table);
+static int rehash(HashTable* table, size_t group_count);
+static size_t find_slot(const HashTable* table,
+                        const char* key, uint64_t key_hash);
+static size_t find_insert_slot(const HashTable* table, uint64_t key_hash);
+static int group_has_empty(const uint8_t* group);
+static size_t claim_empty_slot(HashTable* table, uint64_t key_hash);
+
+static int increment_counter(HashTable* table, const char* key,
+                             uint64_t key_hash, size_t amount);
+static void prefetch_group(const HashTable* table,
+                           const char* const* keys, size_t group_size,
+                           uint64_t* hashes);
+
+__always_inline
+static size_t round_to_pow2(size_t x)
+{
+    size_t result = 1;
+    while (result < x)
+        result <<= 1;
+    return result;
+}
+
+__always_inline
+static uint8_t get_tag(uint64_t key_hash)
+{
+    return (uint8_t) (key_hash & 0x7F);
+}
+
+__always_inline
+static size_t get_home_group(const HashTable* table, uint64_t key_hash)
+{
+    return (key_hash >> 7) & (table->group_count - 1);
+}
+
+__always_inline
+static int is_full(uint8_t ctrl)
+{
+    return (ctrl & 0x80) == 0;
+}
+
+/**
+ * @brief Get number of slots, which may be used with given group count
+ */
+__always_inline
+static size_t get_slot_limit(const HashTable* table, size_t group_count)
+{
+    return (size_t) ((double) (group_count * swiss_group_width)
+                     * table->max_load_factor);
+}
+
+/**
+ * @brief Get bitmask of control bytes in group equal to `tag`
+ */
+template <class Kernels>
+__always_inline
+static uint64_t group_match(const uint8_t* group, uint8_t tag)
+{
+    return Kernels::bytes_match(group, tag);
+}
+
+/**
+ * @brief Get bitmask of empty or deleted control bytes in group
+ */
+template <class Kernels>
+__always_inline
+static uint64_t group_match_free(const uint8_t* group)
+{
+    return Kernels::bytes_high_bit(group);
+}
+
+int hash_table_ctor(HashTable* table, const size_t bucket_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(bucket_count > 0);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    table->max_load_factor = highest_load_factor;
+
+    const size_t min_capacity =
+                (size_t) ((double) bucket_count / highest_load_factor) + 1;
+    const size_t group_count = round_to_pow2(
+                (min_capacity + swiss_group_width - 1) / swiss_group_width);
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+            allocate_slots(table, group_count));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    table->distinct_count = 0;
+    table->total_count = 0;
+
+    return 0;
+}
+
+int hash_table_dtor(HashTable* table)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    free(table->control);
+    free(table->slots);
+    free(table->counts);
+
+    memset(table, 0, sizeof(*table));
+
+    return 0;
+}
+
+int hash_table_set_max_load_factor(HashTable* table, double factor)
+{
+    if (!table) return -1;
+
+    if (factor <= 0 || factor > highest_load_factor)
+        factor = highest_load_factor;
+
+    /* Already used slots do not count towards the new limit */
+    const size_t used = (size_t) ((double) table->capacity
+                                  * table->max_load_factor)
+                      - table->growth_left;
+    const size_t limit = (size_t) ((double) table->capacity * factor);
+
+    table->max_load_factor = factor;
+    table->growth_left = limit > used ? limit - used : 0;
+
+    return 0;
+}
+
+int hash_table_set_reducer(HashTable* table       __attribute__((unused)),
+                           HashTableReducer reducer __attribute__((unused)))
+{
+    /* Groups are always addressed by masking high bits of hash */
+    errno = ENOTSUP;
+    return -1;
+}
+
+int hash_table_reserve(HashTable* table, size_t expected_distinct)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t min_capacity = (size_t) ((double) expected_distinct
+                                          / table->max_load_factor) + 1;
+    const size_t group_count = round_to_pow2(
+                (min_capacity + swiss_group_width - 1) / swiss_group_width);
+
+    if (group_count <= table->group_count)
+        return 0;
+
+    if (rehash(table, group_count) < 0)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+int hash_table_key_increment_counter(HashTable* table, const char* key)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(key   != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return increment_counter(table, key, TableHashPolicy::hash(key), 1);
+}
+
+int hash_table_key_increment_counter_n(HashTable* table,
+                                       const char* key, size_t length)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(key != NULL);
+        ASSERT_TRUE(length <= max_word_length);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
+
+    return hash_table_key_increment_counter(table, padded.data);
+}
+
+int hash_table_key_increase_counter_n(HashTable* table,
+                                      const char* key, size_t length,
+                                      size_t amount)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(key != NULL);
+        ASSERT_TRUE(length <= max_word_length);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    if (amount == 0)
+        return 0;
+
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
+
+    return increment_counter(table, padded.data,
+                             TableHashPolicy::hash(padded.data), amount);
+}
+
+int hash_table_key_increment_counter_batch(HashTable* table,
+                                           const char* const* keys,
+                                           size_t key_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(keys  != NULL || key_count == 0);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    uint64_t hashes[batch_group_size] = {};
+
+    for (size_t start = 0; start < key_count; start += batch_group_size)
+    {
+        const size_t group = key_count - start < batch_group_size
+                                ? key_count - start
+                                : batch_group_size;
+
+        SAFE_BLOCK_START
+        {
+            for (size_t i = 0; i < group; ++i)
+                ASSERT_TRUE(keys[start + i] != NULL);
+        }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            // TODO: Logs
+            errno = EINVAL;
+            return -1;
+        }
+        SAFE_BLOCK_END
+
+        prefetch_group(table, keys + start, group, hashes);
+
+        for (size_t i = 0; i < group; ++i)
+            if (increment_counter(table, keys[start + i], hashes[i], 1) < 0)
+                return -1;
+    }
+
+    return 0;
+}
+
+int hash_table_key_decrement_counter(HashTable* table, const char* key)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(key   != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t slot = find_slot(table, key, TableHashPolicy::hash(key));
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(slot < table->capacity);
+        ASSERT_POSITIVE(table->counts[slot]);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    -- table->counts[slot];
+    -- table->total_count;
+
+    if (table->counts[slot])
+        return 0;
+
+    -- table->distinct_count;
+    memset(table->slots[slot].key, 0, max_word_length);
+
+    /*
+     * Probing stops at the first group with an empty slot. A group with
+     * an empty slot has never been full, so no probe sequence has passed
+     * through it, and the slot can be freed without a tombstone.
+     */
+    const uint8_t* group = table->control
+                         + slot / swiss_group_width * swiss_group_width;
+    if (group_has_empty(group))
+    {
+        table->control[slot] = swiss_ctrl_empty;
+        ++ table->growth_left;
+    }
+    else
+        table->control[slot] = swiss_ctrl_deleted;
+
+    return 0;
+}
+
+int hash_table_key_decrement_counter_n(HashTable* table,
+                                       const char* key, size_t length)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(key != NULL);
+        ASSERT_TRUE(length <= max_word_length);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
+
+    return hash_table_key_decrement_counter(table, padded.data);
+}
+
+size_t hash_table_get_key_count(const HashTable* table, const char* key)
+{
+    /* If there is no table, it does not contain any keys */
+    if (!table || !table->control) return 0;
+
+    /* If there is no key, no table contains it */
+    if (!key) return 0;
+
+    const size_t slot = find_slot(table, key, TableHashPolicy::hash(key));
+
+    return slot < table->capacity ? table->counts[slot] : 0;
+}
+
+size_t hash_table_get_key_count_n(const HashTable* table,
+                                  const char* key, size_t length)
+{
+    /* Keys, which are missing or too long, are not in table */
+    if (!key || length > max_word_length) return 0;
+
+    PaddedKey padded = {};
+    load_padded_key(padded.data, key, length);
+
+    return hash_table_get_key_count(table, padded.data);
+}
+
+int hash_table_get_key_count_batch(const HashTable* table,
+                                   const char* const* keys, size_t key_count,
+                                   size_t* counts)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table  != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(keys   != NULL || key_count == 0);
+        ASSERT_TRUE(counts != NULL || key_count == 0);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    uint64_t hashes[batch_group_size] = {};
+
+    for (size_t start = 0; start < key_count; start += batch_group_size)
+    {
+        const size_t group = key_count - start < batch_group_size
+                                ? key_count - start
+                                : batch_group_size;
+
+        prefetch_group(table, keys + start, group, hashes);
+
+        for (size_t i = 0; i < group; ++i)
+        {
+            const char* key = keys[start + i];
+            if (!key)
+            {
+                counts[start + i] = 0;
+                continue;
+            }
+
+            const size_t slot = find_slot(table, key, hashes[i]);
+            counts[start + i] = slot < table->capacity
+                                    ? table->counts[slot]
+                                    : 0;
+        }
+    }
+
+    return 0;
+}
+
+int hash_table_get_iterator(const HashTable* table, HashTableIterator* it)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(it != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    it->table = table;
+    it->index = table->capacity;
+    it->key = NULL;
+    it->count = 0;
+
+    for (size_t i = 0; i < table->capacity; ++i)
+        if (is_full(table->control[i]))
+        {
+            it->index = i;
+            it->key = table->slots[i].key;
+            it->count = table->counts[i];
+            return 0;
+        }
+
+    return -1;
+}
+
+int hash_table_iterator_has_next(const HashTableIterator* it)
+{
+    if (!it || !it->key) return 0;
+
+    for (size_t i = it->index + 1; i < it->table->capacity; ++i)
+        if (is_full(it->table->control[i]))
+            return 1;
+
+    return 0;
+}
+
+int hash_table_iterator_get_next(HashTableIterator* it)
+{
+    if (!it || !it->key) return -1;
+
+    for (size_t i = it->index + 1; i < it->table->capacity; ++i)
+        if (is_full(it->table->control[i]))
+        {
+            it->index = i;
+            it->key = it->table->slots[i].key;
+            it->count = it->table->counts[i];
+            return 0;
+        }
+
+    return -1;
+}
+
+int hash_table_merge_begin(HashTableMerge* merge, HashTable* table,
+                           HashTable* const* sources, size_t source_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(table->control != NULL);
+        ASSERT_TRUE(sources != NULL || source_count == 0);
+        for (size_t i = 0; i < source_count; ++i)
+            ASSERT_TRUE(sources[i] != NULL && sources[i]->control != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    size_t added = 0;
+    for (size_t i = 0; i < source_count; ++i)
+        added += sources[i]->distinct_count;
+
+    /* Only empty slots are claimed, and table does not grow while sources
+     * are moved, so it must have room for all of them beforehand */
+    size_t group_count = table->group_count;
+    while (table->distinct_count + added >= get_slot_limit(table,
+                                                           group_count))
+        group_count *= 2;
+
+    HashTableMergeSource* merge_sources = NULL;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_SIMPLE(
+            merge_sources = (HashTableMergeSource*)
+                        calloc(source_count + 1, sizeof(*merge_sources)),
+            action_result != NULL);
+        if (table->growth_left < added)
+        {
+            ASSERT_ZERO(
+                rehash(table, group_count));
+        }
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        free(merge_sources);
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < source_count; ++i)
+        merge_sources[i] = { .table = sources[i], .moved = 0 };
+
+    merge->table = table;
+    merge->sources = merge_sources;
+    merge->source_count = source_count;
+
+    return 0;
+}
+
+int hash_table_merge_source(HashTableMerge* merge, size_t index)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(merge->table != NULL);
+        ASSERT_TRUE(index < merge->source_count);
+        ASSERT_ZERO(merge->sources[index].moved);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    HashTable* table = merge->table;
+    HashTableMergeSource* source = &merge->sources[index];
+
+    for (size_t i = 0; i < source->table->capacity; ++i)
+    {
+        if (!is_full(source->table->control[i]))
+            continue;
+
+        const char* key = source->table->slots[i].key;
+        const size_t slot = claim_empty_slot(table,
+                                             TableHashPolicy::hash(key));
+
+        memcpy(table->slots[slot].key, key, sizeof(char) * max_word_length);
+        table->counts[slot] = source->table->counts[i];
+    }
+
+    source->moved = 1;
+
+    return 0;
+}
+
+int hash_table_merge_end(HashTableMerge* merge)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(merge != NULL);
+        ASSERT_TRUE(merge->table != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    HashTable* table = merge->table;
+
+    for (size_t i = 0; i < merge->source_count; ++i)
+    {
+        HashTable* source = merge->sources[i].table;
+
+        if (!merge->sources[i].moved)
+            hash_table_merge_source(merge, i);
+
+        /* Every moved key took an empty slot */
+        table->distinct_count += source->distinct_count;
+        table->total_count += source->total_count;
+        table->growth_left -= source->distinct_count;
+
+        hash_table_dtor(source);
+    }
+
+    free(merge->sources);
+    *merge = {};
+
+    return 0;
+}
+
+/**
+ * @brief Insert key with precomputed hash or increase its counter
+ */
+static int increment_counter(HashTable* table, const char* key,
+                             uint64_t key_hash, size_t amount)
+{
+    size_t slot = find_slot(table, key, key_hash);
+
+    if (slot < table->capacity)
+    {
+        table->counts[slot] += amount;
+        table->total_count += amount;
+        return 0;
+    }
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                try_grow(table));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    slot = find_insert_slot(table, key_hash);
+
+    if (table->control[slot] == swiss_ctrl_empty && table->growth_left)
+        -- table->growth_left;
+
+    table->control[slot] = get_tag(key_hash);
+    memcpy(table->slots[slot].key, key, sizeof(char) * max_word_length);
+    table->counts[slot] = amount;
+
+    ++ table->distinct_count;
+    table->total_count += amount;
+
+    return 0;
+}
+
+/**
+ * @brief Hash group of keys and prefetch their home control groups and
+ * slots, so that memory loads for all keys are issued before any of them
+ * is resolved
+ *
+ * @param[out] hashes   - Hashes of keys
+ */
+static void prefetch_group(const HashTable* table,
+                           const char* const* keys, size_t group_size,
+                           uint64_t* hashes)
+{
+    TableHashPolicy::hash_batch(keys, group_size, hashes);
+
+    for (size_t i = 0; i < group_size; ++i)
+    {
+        if (!keys[i])
+            continue;
+
+        const size_t group = get_home_group(table, hashes[i]);
+        __builtin_prefetch(table->control + group * swiss_group_width);
+        __builtin_prefetch(table->slots   + group * swiss_group_width);
+    }
+}
+
+/**
+ * @brief Find slot containing `key`
+ *
+ * @return Slot index, or `table->capacity` if key is not present
+ */
+template <class Kernels>
+static size_t find_slot_impl(const HashTable* table,
+                             const char* key, uint64_t key_hash)
+{
+    const uint8_t tag = get_tag(key_hash);
+    const size_t group_mask = table->group_count - 1;
+
+    size_t group = get_home_group(table, key_hash);
+
+    /* Triangular probing visits every group when group count is 2^n */
+    for (size_t step = 1; step <= table->group_count; ++step)
+    {
+        const uint8_t* ctrl = table->control + group * swiss_group_width;
+        const size_t first_slot = group * swiss_group_width;
+
+        for (uint64_t match = group_match<Kernels>(ctrl, tag); match;
+             match &= match - 1)
+        {
+            const size_t slot = first_slot + (size_t) __builtin_ctzll(match);
+            if (Kernels::keys_equal(table->slots[slot].key, key))
+                return slot;
+        }
+
+        if (group_match<Kernels>(ctrl, swiss_ctrl_empty))
+            break;
+
+        group = (group + step) & group_mask;
+    }
+
+    return table->capacity;
+}
+
+KEY_KERNELS_DISPATCH(size_t, find_slot,
+                     (const HashTable* table,
+                      const char* key, uint64_t key_hash),
+                     (table, key, key_hash))
+
+/**
+ * @brief Find first empty or deleted slot in probe sequence of `key_hash`
+ */
+template <class Kernels>
+static size_t find_insert_slot_impl(const HashTable* table,
+                                    uint64_t key_hash)
+{
+    const size_t group_mask = table->group_count - 1;
+
+    size_t group = get_home_group(table, key_hash);
+
+    for (size_t step = 1; ; ++step)
+    {
+        const uint8_t* ctrl = table->control + group * swiss_group_width;
+        const uint64_t match = group_match_free<Kernels>(ctrl);
+
+        if (match)
+            return group * swiss_group_width
+                 + (size_t) __builtin_ctzll(match);
+
+        group = (group + step) & group_mask;
+    }
+}
+
+KEY_KERNELS_DISPATCH(size_t, find_insert_slot,
+                     (const HashTable* table, uint64_t key_hash),
+                     (table, key_hash))
+
+/**
+ * @brief Check if group has empty slot
+ */
+template <class Kernels>
+static int group_has_empty_impl(const uint8_t* group)
+{
+    return group_match<Kernels>(group, swiss_ctrl_empty) != 0;
+}
+
+KEY_KERNELS_DISPATCH(int, group_has_empty,
+                     (const uint8_t* group),
+                     (group))
+
+/**
+ * @brief Find empty slot in probe sequence of `key_hash` and tag it. Slots
+ * may be claimed by several threads at once, so control bytes are
+ * accessed atomically
+ */
+static size_t claim_empty_slot(HashTable* table, uint64_t key_hash)
+{
+    const uint8_t tag = get_tag(key_hash);
+    const size_t group_mask = table->group_count - 1;
+
+    size_t group = get_home_group(table, key_hash);
+
+    for (size_t step = 1; ; ++step)
+    {
+        uint8_t* ctrl = table->control + group * swiss_group_width;
+
+        for (size_t i = 0; i < swiss_group_width; ++i)
+        {
+            uint8_t expected = swiss_ctrl_empty;
+            if (__atomic_load_n(&ctrl[i], __ATOMIC_RELAXED) == expected
+                && __atomic_compare_exchange_n(&ctrl[i], &expected, tag,
+                                               false, __ATOMIC_RELAXED,
+                                               __ATOMIC_RELAXED))
+                return group * swiss_group_width + i;
+        }
+
+        group = (group + step) & group_mask;
+    }
+}
+
+static int allocate_slots(HashTable* table, size_t group_count)
+{
+    const size_t capacity = group_count * swiss_group_width;
+
+    uint8_t* control = NULL;
+    HashTableSlot* slots = NULL;
+    size_t* counts = NULL;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+            posix_memalign((void**)&control,
+                            max_word_length, sizeof(*control)*capacity));
+        ASSERT_ZERO(
+            posix_memalign((void**)&slots,
+                            max_word_length, sizeof(*slots)*capacity));
+        ASSERT_SIMPLE(
+            counts = (size_t*) calloc(capacity, sizeof(*counts)),
+            action_result != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        free(control);
+        free(slots);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    memset(control, swiss_ctrl_empty, sizeof(*control)*capacity);
+
+    table->control = control;
+    table->slots = slots;
+    table->counts = counts;
+
+    table->group_count = group_count;
+    table->capacity = capacity;
+    table->growth_left = (size_t) ((double) capacity
+                                   * table->max_load_factor);
+
+    return 0;
+}
+
+static int try_grow(HashTable* table)
+{
+    if (table->growth_left) return 0;
+
+    /* If most of used slots are tombstones, rehashing in place is enough.
+     * Otherwise table grows until it has room for new key */
+    size_t new_group_count = table->group_count;
+    if (table->distinct_count * 2 >= get_slot_limit(table, new_group_count))
+    {
+        do
+            new_group_count *= 2;
+        while (table->distinct_count >= get_slot_limit(table,
+                                                       new_group_count));
+    }
+
+    return rehash(table, new_group_count);
+}
+
+/**
+ * @brief Move all entries to new slot array with given number of groups
+ */
+static int rehash(HashTable* table, size_t group_count)
+{
+    HashTable old_table = *table;
+
+    if (allocate_slots(table, group_count) < 0)
+    {
+        // TODO: Logs
+        return -1;
+    }
+
+    for (size_t i = 0; i < old_table.capacity; ++i)
+    {
+        if (!is_full(old_table.control[i]))
+            continue;
+
+        const char* key = old_table.slots[i].key;
+        const uint64_t key_hash = TableHashPolicy::hash(key);
+        const size_t slot = find_insert_slot(table, key_hash);
+
+        table->control[slot] = get_tag(key_hash);
+        memcpy(table->slots[slot].key, key, sizeof(char) * max_word_length);
+        table->counts[slot] = old_table.counts[i];
+        if (table->growth_left)
+            -- table->growth_left;
+    }
+
+    free(old_table.control);
+    free(old_table.slots);
+    free(old_table.counts);
+
+    return 0;
+}
+
+#endif /* HASH_TABLE_SWISS */
@@ -1,7 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include "table_utils/utils.h"
+#include "table_utils/parallel_fill.h"
 #include "meerkat_assert/asserts.h"
 
 #include "program.h"
@@ -12,6 +16,36 @@ static size_t max(size_t a, size_t b)
     return a > b ? a : b;
 }
 
+/**
+ * @brief Loading of single input file
+ */
+struct FillTask
+{
+    HashTable* table;
+    const char* filename;
+    const ProgramConfig* config;
+    size_t thread_count;
+
+    int result;
+    int error;
+};
+
+static void* run_fill_task(void* task_ptr)
+{
+    FillTask* task = (FillTask*) task_ptr;
+    const ProgramConfig* config = task->config;
+
+    task->result = config->raw_text
+                    ? fill_hash_table_from_text(task->table, task->filename,
+                                                config->max_words)
+                    : fill_hash_table_parallel(task->table, task->filename,
+                                               config->max_words,
+                                               task->thread_count);
+    task->error = errno;
+
+    return NULL;
+}
+
 int program_init(ProgramState* state, const ProgramConfig* config)
 {
     SAFE_BLOCK_START
@@ -20,6 +54,12 @@ int program_init(ProgramState* state, const ProgramConfig* config)
             hash_table_ctor(&state->file1_words, hash_table_bucket_count));
         ASSERT_ZERO(
             hash_table_ctor(&state->file2_words, hash_table_bucket_count));
+        ASSERT_ZERO(
+            hash_table_set_max_load_factor(&state->file1_words,
+                                           config->load_factor));
+        ASSERT_ZERO(
+            hash_table_set_max_load_factor(&state->file2_words,
+                                           config->load_factor));
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -28,23 +68,42 @@ int program_init(ProgramState* state, const ProgramConfig* config)
     }
     SAFE_BLOCK_END
 
-    SAFE_BLOCK_START
-    {
-        ASSERT_ZERO_MESSAGE(
-                fill_hash_table(&state->file1_words,
-                    config->filename1, config->max_words),
-                config->filename1);
-        ASSERT_ZERO_MESSAGE(
-                fill_hash_table(&state->file2_words,
-                    config->filename2, config->max_words),
-                config->filename2);
-    }
-    SAFE_BLOCK_HANDLE_ERRORS
+    /* Files are loaded concurrently, each by half of threads */
+    FillTask tasks[2] = {
+        {
+            .table = &state->file1_words,
+            .filename = config->filename1,
+            .config = config,
+            .thread_count = (config->thread_count + 1) / 2
+        },
+        {
+            .table = &state->file2_words,
+            .filename = config->filename2,
+            .config = config,
+            .thread_count = max(config->thread_count / 2, 1)
+        }
+    };
+
+    pthread_t second_loader = {};
+    const int concurrent = config->thread_count > 1
+                        && pthread_create(&second_loader, NULL,
+                                          run_fill_task, &tasks[1]) == 0;
+
+    run_fill_task(&tasks[0]);
+    if (concurrent)
+        pthread_join(second_loader, NULL);
+    else
+        run_fill_task(&tasks[1]);
+
+    for (size_t i = 0; i < 2; ++i)
     {
-        fprintf(stderr, "Failed to read file '%s'\n", assertion_info.message);
+        if (tasks[i].result == 0)
+            continue;
+
+        errno = tasks[i].error;
+        fprintf(stderr, "Failed to read file '%s'\n", tasks[i].filename);
         return -1;
     }
-    SAFE_BLOCK_END
     
     if (!config->print_verbose)
     {
@@ -97,7 +156,9 @@ int program_compare_files(ProgramState* state, const ProgramConfig* config)
 
         for (ssize_t i = 0; i < cnt; ++i)
         {
-            fputs(state->diff_array[i], config->output);
+            fwrite(state->diff_array[i], 1,
+                   strnlen(state->diff_array[i], max_word_length),
+                   config->output);
             fputc('\n', config->output);
         }
         
@@ -120,7 +181,9 @@ int program_compare_files(ProgramState* state, const ProgramConfig* config)
 
         for (ssize_t i = 0; i < cnt; ++i)
         {
-            fputs(state->diff_array[i], config->output);
+            fwrite(state->diff_array[i], 1,
+                   strnlen(state->diff_array[i], max_word_length),
+                   config->output);
             fputc('\n', config->output);
         }
         
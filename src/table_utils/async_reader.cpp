@@ -0,0 +1,508 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "async_reader.h"
+
+/* Alignment of buffers, offsets and sizes for `O_DIRECT` reads */
+static const size_t direct_alignment = 4096;
+
+static int ring_init(AsyncReaderRing* ring);
+static void ring_destroy(AsyncReaderRing* ring);
+static int ring_submit_block(AsyncReader* reader, size_t block);
+static int ring_wait_block(AsyncReader* reader, size_t block);
+
+static int thread_start(AsyncReader* reader);
+static void* thread_read_blocks(void* reader_ptr);
+
+int async_reader_open(AsyncReader* reader, const char* filename,
+                      size_t limit)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(reader != NULL);
+        ASSERT_TRUE(filename != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    *reader = {};
+
+    struct stat input_stat = {};
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &input_stat) < 0)
+    {
+        // TODO: Logs
+        if (fd >= 0) close(fd);
+        errno = EACCES;
+        return -1;
+    }
+
+    reader->size = (size_t) input_stat.st_size < limit
+                 ? (size_t) input_stat.st_size
+                 : limit;
+    reader->block_count = (reader->size + async_reader_block_size - 1)
+                        / async_reader_block_size;
+
+    /* File which does not fit in memory cannot stay cached anyway, caching
+     * it would only evict other data. Filesystems without `O_DIRECT`
+     * support are read through page cache */
+    const size_t memory_size = (size_t) sysconf(_SC_PHYS_PAGES)
+                             * (size_t) sysconf(_SC_PAGE_SIZE);
+    if (reader->size > memory_size)
+    {
+        const int direct_fd = open(filename, O_RDONLY | O_DIRECT);
+        if (direct_fd >= 0)
+        {
+            close(fd);
+            fd = direct_fd;
+        }
+    }
+    reader->fd = fd;
+
+    if (posix_memalign((void**) &reader->buffers, direct_alignment,
+                       async_reader_depth * async_reader_block_size))
+    {
+        // TODO: Logs
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    reader->uses_ring = ring_init(&reader->ring) == 0;
+
+    if (reader->uses_ring)
+    {
+        while (reader->issued_blocks < reader->block_count &&
+               reader->issued_blocks < async_reader_depth)
+        {
+            if (ring_submit_block(reader, reader->issued_blocks) < 0)
+            {
+                /* Requests, which were already submitted, are still read
+                 * into buffers, so they are kept until completion */
+                async_reader_close(reader);
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    if (thread_start(reader) < 0)
+    {
+        // TODO: Logs
+        close(fd);
+        free(reader->buffers);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+ssize_t async_reader_next(AsyncReader* reader, const char** data)
+{
+    const size_t block = reader->next_block;
+    const size_t slot  = block % async_reader_depth;
+
+    if (reader->uses_ring)
+    {
+        if (reader->holds_block && reader->issued_blocks < reader->block_count
+            && ring_submit_block(reader, reader->issued_blocks) < 0)
+        {
+            // TODO: Logs
+            errno = EACCES;
+            return -1;
+        }
+        reader->holds_block = 0;
+
+        if (block >= reader->block_count)
+            return 0;
+
+        if (ring_wait_block(reader, block) < 0)
+        {
+            // TODO: Logs
+            errno = EACCES;
+            return -1;
+        }
+
+        reader->holds_block = 1;
+        reader->next_block = block + 1;
+    }
+    else
+    {
+        pthread_mutex_lock(&reader->lock);
+
+        reader->holds_block = 0;
+        pthread_cond_broadcast(&reader->changed);
+
+        while (reader->read_blocks <= block && !reader->error &&
+               block < reader->block_count)
+            pthread_cond_wait(&reader->changed, &reader->lock);
+
+        const int error = reader->error;
+        const int at_end = block >= reader->block_count;
+        if (!error && !at_end)
+        {
+            reader->holds_block = 1;
+            reader->next_block = block + 1;
+        }
+        pthread_mutex_unlock(&reader->lock);
+
+        if (error)
+        {
+            // TODO: Logs
+            errno = EACCES;
+            return -1;
+        }
+
+        if (at_end)
+            return 0;
+    }
+
+    *data = reader->buffers + slot * async_reader_block_size;
+    return (ssize_t) reader->filled[slot];
+}
+
+void async_reader_close(AsyncReader* reader)
+{
+    if (reader->uses_ring)
+    {
+        /* Waiting for block past the last issued one reaps all reads */
+        ring_wait_block(reader, reader->issued_blocks);
+        ring_destroy(&reader->ring);
+    }
+    else
+    {
+        pthread_mutex_lock(&reader->lock);
+        reader->stop = 1;
+        pthread_cond_broadcast(&reader->changed);
+        pthread_mutex_unlock(&reader->lock);
+
+        pthread_join(reader->thread, NULL);
+        pthread_cond_destroy(&reader->changed);
+        pthread_mutex_destroy(&reader->lock);
+    }
+
+    close(reader->fd);
+    free(reader->buffers);
+    *reader = {};
+}
+
+/**
+ * @brief Get number of bytes in block
+ */
+__always_inline
+static size_t get_block_length(const AsyncReader* reader, size_t block)
+{
+    const size_t offset = block * async_reader_block_size;
+    return reader->size - offset < async_reader_block_size
+            ? reader->size - offset
+            : async_reader_block_size;
+}
+
+__always_inline
+static long io_uring_setup(unsigned entries, io_uring_params* params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+__always_inline
+static long io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                           unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                   NULL, 0);
+}
+
+/**
+ * @brief Map ring memory at given offset of io_uring file
+ *
+ * @return Mapped memory, NULL upon error
+ */
+static void* ring_map(int fd, size_t size, off_t offset)
+{
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, offset);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+/**
+ * @brief Set up io_uring instance with entry for every buffer
+ *
+ * @return 0 upon success, -1 if io_uring is unavailable
+ */
+static int ring_init(AsyncReaderRing* ring)
+{
+    io_uring_params params = {};
+
+    const long fd = io_uring_setup(async_reader_depth, &params);
+    if (fd < 0)
+        return -1;
+
+    /* Reads with offset (IORING_OP_READ) predate fast poll, which is
+     * checked instead of probing opcodes */
+    if (!(params.features & IORING_FEAT_FAST_POLL) ||
+        !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close((int) fd);
+        return -1;
+    }
+
+    ring->fd = (int) fd;
+
+    const size_t sq_size = params.sq_off.array
+                         + params.sq_entries * sizeof(unsigned);
+    const size_t cq_size = params.cq_off.cqes
+                         + params.cq_entries * sizeof(io_uring_cqe);
+
+    /* Both rings share single mapping */
+    ring->rings_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->entries_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    ring->rings = ring_map(ring->fd, ring->rings_size,
+                           (off_t) IORING_OFF_SQ_RING);
+    ring->entries = ring_map(ring->fd, ring->entries_size,
+                             (off_t) IORING_OFF_SQES);
+    if (!ring->rings || !ring->entries)
+    {
+        ring_destroy(ring);
+        return -1;
+    }
+
+    char* const sq = (char*) ring->rings;
+    char* const cq = sq;
+
+    ring->sq_tail  = (unsigned*) (sq + params.sq_off.tail);
+    ring->sq_mask  = (unsigned*) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*) (sq + params.sq_off.array);
+    ring->cq_head  = (unsigned*) (cq + params.cq_off.head);
+    ring->cq_tail  = (unsigned*) (cq + params.cq_off.tail);
+    ring->cq_mask  = (unsigned*) (cq + params.cq_off.ring_mask);
+    ring->completions = cq + params.cq_off.cqes;
+
+    return 0;
+}
+
+static void ring_destroy(AsyncReaderRing* ring)
+{
+    if (ring->rings) munmap(ring->rings, ring->rings_size);
+    if (ring->entries) munmap(ring->entries, ring->entries_size);
+    close(ring->fd);
+    *ring = {};
+}
+
+/**
+ * @brief Submit read of unread part of block into its buffer
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int ring_submit_read(AsyncReader* reader, size_t block)
+{
+    AsyncReaderRing* ring = &reader->ring;
+    const size_t slot = block % async_reader_depth;
+    const size_t filled = reader->filled[slot];
+
+    /* Lengths are rounded up to alignment of direct reads. Reading
+     * past end of block is harmless, as extra bytes are ignored */
+    size_t length = get_block_length(reader, block) - filled;
+    length = (length + direct_alignment - 1) & ~(direct_alignment - 1);
+    if (length > async_reader_block_size - filled)
+        length = async_reader_block_size - filled;
+
+    const unsigned tail = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+    io_uring_sqe* entry = (io_uring_sqe*) ring->entries + index;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode    = IORING_OP_READ;
+    entry->fd        = reader->fd;
+    entry->addr      = (unsigned long) (reader->buffers
+                                        + slot * async_reader_block_size
+                                        + filled);
+    entry->len       = (unsigned) length;
+    entry->off       = block * async_reader_block_size + filled;
+    entry->user_data = block;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (io_uring_enter(ring->fd, 1, 0, 0) != 1)
+        return -1;
+
+    ++ ring->in_flight;
+    return 0;
+}
+
+static int ring_submit_block(AsyncReader* reader, size_t block)
+{
+    const size_t slot = block % async_reader_depth;
+
+    reader->filled[slot] = 0;
+    reader->completed[slot] = 0;
+    if (ring_submit_read(reader, block) < 0)
+        return -1;
+
+    ++ reader->issued_blocks;
+    return 0;
+}
+
+/**
+ * @brief Process completions until block is read. Short reads are
+ * continued by submitting read of the rest of block
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EIO   - some read failed
+ */
+static int ring_wait_block(AsyncReader* reader, size_t block)
+{
+    AsyncReaderRing* ring = &reader->ring;
+    const size_t slot = block % async_reader_depth;
+    int result = 0;
+
+    while (ring->in_flight &&
+           (block >= reader->issued_blocks || !reader->completed[slot]))
+    {
+        unsigned head = *ring->cq_head;
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            if (io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0
+                && errno != EINTR)
+                return -1;
+            continue;
+        }
+
+        const io_uring_cqe completion =
+                ((io_uring_cqe*) ring->completions)[head & *ring->cq_mask];
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        -- ring->in_flight;
+
+        const size_t done_block = completion.user_data;
+        const size_t done_slot  = done_block % async_reader_depth;
+        const size_t length = get_block_length(reader, done_block);
+
+        if (completion.res < 0)
+        {
+            result = -1;
+            errno = EIO;
+            reader->completed[done_slot] = 1;
+            continue;
+        }
+
+        reader->filled[done_slot] += (size_t) completion.res;
+
+        if (completion.res > 0 && reader->filled[done_slot] < length)
+        {
+            if (ring_submit_read(reader, done_block) < 0)
+                return -1;
+            continue;
+        }
+
+        /* File might be truncated after it was opened */
+        if (reader->filled[done_slot] > length)
+            reader->filled[done_slot] = length;
+        reader->completed[done_slot] = 1;
+    }
+
+    return result;
+}
+
+static int thread_start(AsyncReader* reader)
+{
+    if (pthread_mutex_init(&reader->lock, NULL) != 0)
+        return -1;
+
+    if (pthread_cond_init(&reader->changed, NULL) != 0)
+    {
+        pthread_mutex_destroy(&reader->lock);
+        return -1;
+    }
+
+    if (pthread_create(&reader->thread, NULL,
+                       thread_read_blocks, reader) != 0)
+    {
+        pthread_cond_destroy(&reader->changed);
+        pthread_mutex_destroy(&reader->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Read blocks in order with `pread()`, waiting for caller to
+ * release buffer before reusing it
+ */
+static void* thread_read_blocks(void* reader_ptr)
+{
+    AsyncReader* reader = (AsyncReader*) reader_ptr;
+
+    for (size_t block = 0; block < reader->block_count; ++block)
+    {
+        pthread_mutex_lock(&reader->lock);
+        while (!reader->stop && block >= reader->next_block
+                                          - (size_t) reader->holds_block
+                                          + async_reader_depth)
+            pthread_cond_wait(&reader->changed, &reader->lock);
+        const int stop = reader->stop;
+        pthread_mutex_unlock(&reader->lock);
+
+        if (stop)
+            break;
+
+        const size_t slot = block % async_reader_depth;
+        const size_t length = get_block_length(reader, block);
+        char* const buffer = reader->buffers + slot * async_reader_block_size;
+        size_t filled = 0;
+        int error = 0;
+
+        while (filled < length)
+        {
+            size_t to_read = length - filled;
+            to_read = (to_read + direct_alignment - 1)
+                    & ~(direct_alignment - 1);
+            if (to_read > async_reader_block_size - filled)
+                to_read = async_reader_block_size - filled;
+
+            const ssize_t read_result = pread(reader->fd, buffer + filled,
+                                    to_read,
+                                    (off_t) (block * async_reader_block_size
+                                             + filled));
+            if (read_result < 0 && errno == EINTR)
+                continue;
+            if (read_result < 0)
+                error = 1;
+            if (read_result <= 0)
+                break;
+
+            filled += (size_t) read_result;
+        }
+
+        pthread_mutex_lock(&reader->lock);
+        reader->filled[slot] = filled < length ? filled : length;
+        reader->read_blocks = block + 1;
+        reader->error = error;
+        pthread_cond_broadcast(&reader->changed);
+        pthread_mutex_unlock(&reader->lock);
+
+        if (error)
+            break;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file async_reader.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Sequential file reader, which keeps several reads in flight while
+ * caller processes already filled buffers. Reads are submitted through
+ * io_uring, with fallback to `pread()` in background thread when io_uring
+ * is unavailable
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TABLE_UTILS_ASYNC_READER_H
+#define __TABLE_UTILS_ASYNC_READER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Number of buffers, filled concurrently with processing */
+static constexpr size_t async_reader_depth = 4;
+
+/* Size of single read. Multiple of page size and `max_word_length`, so
+ * buffers are suitable for `O_DIRECT` and never split words */
+static constexpr size_t async_reader_block_size = 1 << 20;
+
+/**
+ * @brief Mapped rings of io_uring instance
+ */
+struct AsyncReaderRing
+{
+    int fd;
+
+    void*   rings;
+    size_t  rings_size;
+    void*   entries;
+    size_t  entries_size;
+
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    void*     completions;
+
+    size_t in_flight;
+};
+
+/**
+ * @brief Reader of file in blocks of `async_reader_block_size` bytes. Block
+ * `i` is read into buffer `i % async_reader_depth`
+ */
+struct AsyncReader
+{
+    int fd;
+    size_t size;
+    size_t block_count;
+
+    char*  buffers;
+    size_t filled[async_reader_depth];
+    int    completed[async_reader_depth];
+
+    size_t next_block;
+    size_t issued_blocks;
+    int    holds_block;
+
+    int uses_ring;
+    AsyncReaderRing ring;
+
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;
+    size_t          read_blocks;
+    int             stop;
+    int             error;
+};
+
+/**
+ * @brief Open file and start reading its first blocks. Files, larger than
+ * physical memory, are read with `O_DIRECT`, bypassing page cache
+ *
+ * @param[out] reader	- Reader to initialize
+ * @param[in]  filename	- Path to regular file
+ * @param[in]  limit	- Maximum number of bytes to read
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - reader or filename is NULL
+ * @exception EACCES    - failed to open file
+ * @exception ENOMEM    - failed to allocate buffers or start reading
+ */
+int async_reader_open(AsyncReader* reader, const char* filename,
+                      size_t limit);
+
+/**
+ * @brief Get next block of file. Buffer of previous block is reused for
+ * reading, so previously returned data becomes invalid
+ *
+ * @param[inout] reader	- Opened reader
+ * @param[out]   data	- Contents of next block
+ *
+ * @return Size of block, 0 at end of file, -1 upon error
+ *
+ * @exception EACCES    - failed to read file
+ */
+ssize_t async_reader_next(AsyncReader* reader, const char** data);
+
+/**
+ * @brief Wait for reads in flight, then close file and free buffers
+ *
+ * @param[inout] reader	- Opened reader
+ */
+void async_reader_close(AsyncReader* reader);
+
+#endif /* async_reader.h */
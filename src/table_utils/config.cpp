@@ -1,9 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "meerkat_assert/asserts.h"
 
+#include "hash_table/hashes/hash_functions.h"
+
 #include "utils.h"
 #include "config.h"
 
@@ -14,6 +18,11 @@ int configure_program(int argc, const char* const* argv, ProgramConfig* config)
     config->output = stdout;
     config->print_verbose = 0;
     config->max_words = -1;
+    config->load_factor = hash_table_default_load_factor;
+    config->raw_text = 0;
+
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    config->thread_count = cpu_count > 0 ? (size_t) cpu_count : 1;
 
     SAFE_BLOCK_START
     {
@@ -125,6 +134,95 @@ int config_set_max_words(const char* const* str, void* params)
     return 1;
 }
 
+int config_set_load_factor(const char* const* str, void* params)
+{
+    ProgramConfig* config = (ProgramConfig*) params;
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(
+            str[0] != NULL,
+            "Expected a number");
+
+        char* endptr = NULL;
+        double factor = strtod(str[0], &endptr);
+        ASSERT_TRUE_MESSAGE(
+            *str[0] != '\0' && *endptr == '\0',
+            "Invalid number");
+        ASSERT_TRUE_MESSAGE(
+            factor >= 0, "Expected non-negative number");
+        config->load_factor = factor;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fputs(assertion_info.message, stderr);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 1;
+}
+
+int config_set_raw_text([[maybe_unused]] const char* const* str,
+                                         void* params)
+{
+    ProgramConfig* config = (ProgramConfig*) params;
+    config->raw_text = 1;
+    return 0;
+}
+
+int config_set_thread_count(const char* const* str, void* params)
+{
+    ProgramConfig* config = (ProgramConfig*) params;
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(
+            str[0] != NULL,
+            "Expected an integer");
+
+        char* endptr = NULL;
+        long number = strtol(str[0], &endptr, 10);
+        ASSERT_TRUE_MESSAGE(
+            *str[0] != '\0' && *endptr == '\0',
+            "Invalid number");
+        ASSERT_POSITIVE_MESSAGE(
+            number, "Expected positive number");
+        config->thread_count = (size_t) number;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fputs(assertion_info.message, stderr);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 1;
+}
+
+int config_set_hash_function(const char* const* str,
+                             void* params __attribute__((unused)))
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(
+            str[0] != NULL,
+            "Expected hash function name\n");
+        ASSERT_ZERO_MESSAGE(
+            hash_runtime_select(str[0]),
+            errno == ENOTSUP
+                ? "Hash function is fixed at build time,"
+                  " rebuild with HASH_FUNC=hash_runtime\n"
+                : "Unknown hash function\n");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fputs(assertion_info.message, stderr);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 1;
+}
+
 int config_add_input_file(const char* const* str, void* params)
 {
     ProgramConfig* config = (ProgramConfig*) params;
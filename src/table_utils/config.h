@@ -26,6 +26,9 @@ struct ProgramConfig
     FILE* output;
     int print_verbose;
     ssize_t max_words;
+    double load_factor;
+    int raw_text;
+    size_t thread_count;
 };
 
 /**
@@ -83,6 +86,47 @@ int config_set_verbose(const char* const* str, void* params);
  */
 int config_set_max_words(const char* const* str, void* params);
 
+/**
+ * @brief Set maximum load factor of hash tables
+ * 
+ * @param[in]    str    - Input arguments
+ * @param[inout] params - `ProgramConfig` instance
+ *
+ * @return 1 on successful parse, -1 otherwise
+ */
+int config_set_load_factor(const char* const* str, void* params);
+
+/**
+ * @brief Read input files as raw text instead of converted word lists
+ * 
+ * @param[in]    str    - Input arguments
+ * @param[inout] params - `ProgramConfig` instance
+ *
+ * @return 0
+ */
+int config_set_raw_text(const char* const* str, void* params);
+
+/**
+ * @brief Set number of threads reading input files
+ * 
+ * @param[in]    str    - Input arguments
+ * @param[inout] params - `ProgramConfig` instance
+ *
+ * @return 1 on successful parse, -1 otherwise
+ */
+int config_set_thread_count(const char* const* str, void* params);
+
+/**
+ * @brief Select hash function of hash tables. Requires build with
+ * HASH_FUNC=hash_runtime
+ * 
+ * @param[in]    str    - Input arguments
+ * @param[inout] params - `ProgramConfig` instance
+ *
+ * @return 1 on successful parse, -1 otherwise
+ */
+int config_set_hash_function(const char* const* str, void* params);
+
 /**
  * @brief Add input file for program
  * 
@@ -121,6 +165,37 @@ static const arg_tag PARAMETER_TAGS[] = {
         .callback = config_set_max_words,
         .description = 
             "Read only first <n> words from both files"
+    },
+    {
+        .short_tag = 'l',
+        .long_tag = "load-factor",
+        .callback = config_set_load_factor,
+        .description = 
+            "Grow hash tables when there are more than <l> words per bucket"
+            " (0 disables growth)"
+    },
+    {
+        .short_tag = 't',
+        .long_tag = "text",
+        .callback = config_set_raw_text,
+        .description = 
+            "Read input files as raw UTF-8 text instead of files produced"
+            " by convert.py"
+    },
+    {
+        .short_tag = 'j',
+        .long_tag = "threads",
+        .callback = config_set_thread_count,
+        .description = 
+            "Read input files using <j> threads (number of CPUs by default)"
+    },
+    {
+        .short_tag = 'H',
+        .long_tag = "hash",
+        .callback = config_set_hash_function,
+        .description = 
+            "Hash words with given function (e.g. hash_crc32c). Requires"
+            " build with HASH_FUNC=hash_runtime"
     }
 };
 
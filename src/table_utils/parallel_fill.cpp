@@ -0,0 +1,684 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "utils.h"
+#include "parallel_fill.h"
+
+/* Threads are not started for fewer words than this */
+static const size_t min_words_per_thread = 1 << 16;
+
+/* Number of keys passed to hash table in one batch call */
+static const size_t key_batch_size = 64;
+
+/* Initial bucket count of thread tables */
+static const size_t partial_table_bucket_count = 1 << 10;
+
+/**
+ * @brief Entry of thread table, passed to thread merging its partition
+ */
+struct MergeEntry
+{
+    const char* key;
+    size_t length;
+    size_t count;
+    size_t partition;
+};
+
+/**
+ * @brief State of single thread. Thread `i` counts words of range `i`
+ * in `words`, then merges partition `i` of all `words` tables into
+ * `partition` and moves it into result by `merge`. When filling shared
+ * table, words are counted in `shared` or `lockfree` instead
+ */
+struct FillWorker
+{
+    const char* text;
+    size_t word_count;
+    double max_load_factor;
+
+    ConcurrentHashTable* shared;
+    LockFreeHashTable* lockfree;
+
+    HashTable words;
+    MergeEntry* entries;
+    size_t* partition_starts;
+
+    HashTable partition;
+    HashTableMerge* merge;
+
+    FillWorker* workers;
+    size_t worker_count;
+    size_t index;
+
+    int error;
+};
+
+static void* count_words(void* worker_ptr);
+static void* split_partitions(void* worker_ptr);
+static void* merge_partition(void* worker_ptr);
+static void* move_partition(void* worker_ptr);
+static void* count_shared_words(void* worker_ptr);
+static int fill_shared_table(ConcurrentHashTable* shared,
+                             LockFreeHashTable* lockfree,
+                             const char* filename, ssize_t max_words,
+                             size_t thread_count);
+static FillWorker* create_workers(const char* text, size_t word_count,
+                                  size_t worker_count);
+static int run_workers(FillWorker* workers, size_t worker_count,
+                       void* (*routine)(void*));
+static int merge_into_table(HashTable* table,
+                            FillWorker* workers, size_t worker_count);
+static int add_to_table(HashTable* table,
+                        FillWorker* workers, size_t worker_count);
+static void destroy_workers(FillWorker* workers, size_t worker_count);
+
+int fill_hash_table_parallel(HashTable* table, const char* filename,
+                             ssize_t max_words, size_t thread_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(filename);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const int input = open(filename, O_RDONLY);
+    if (input < 0)
+    {
+        // TODO: Logs
+        errno = EACCES;
+        return -1;
+    }
+
+    struct stat input_stat = {};
+    size_t word_count = fstat(input, &input_stat) == 0
+                     && S_ISREG(input_stat.st_mode)
+                        ? (size_t) input_stat.st_size / max_word_length
+                        : 0;
+    if (max_words >= 0 && (size_t) max_words < word_count)
+        word_count = (size_t) max_words;
+
+    size_t worker_count = word_count / min_words_per_thread;
+    if (worker_count > thread_count)
+        worker_count = thread_count;
+
+    void* mapping = MAP_FAILED;
+    if (worker_count > 1)
+        mapping = mmap(NULL, word_count * max_word_length, PROT_READ,
+                       MAP_PRIVATE, input, 0);
+    close(input);
+
+    /* Pipes, small files and files which cannot be mapped are not split */
+    if (mapping == MAP_FAILED)
+        return fill_hash_table(table, filename, max_words);
+
+    FillWorker* workers = create_workers((const char*) mapping,
+                                         word_count, worker_count);
+    if (!workers)
+    {
+        // TODO: Logs
+        munmap(mapping, word_count * max_word_length);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < worker_count; ++i)
+        workers[i].max_load_factor = table->max_load_factor;
+
+    int result = 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                run_workers(workers, worker_count, count_words));
+        ASSERT_ZERO(
+                run_workers(workers, worker_count, split_partitions));
+        ASSERT_ZERO(
+                run_workers(workers, worker_count, merge_partition));
+        ASSERT_ZERO(
+                merge_into_table(table, workers, worker_count));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        result = -1;
+    }
+    SAFE_BLOCK_END
+
+    const int error = errno;
+
+    destroy_workers(workers, worker_count);
+    munmap(mapping, word_count * max_word_length);
+
+    errno = error;
+    return result;
+}
+
+int fill_concurrent_table(ConcurrentHashTable* table, const char* filename,
+                          ssize_t max_words, size_t thread_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(filename);
+        ASSERT_POSITIVE(thread_count);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return fill_shared_table(table, NULL, filename, max_words, thread_count);
+}
+
+int fill_lockfree_table(LockFreeHashTable* table, const char* filename,
+                        ssize_t max_words, size_t thread_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
+        ASSERT_TRUE(filename);
+        ASSERT_POSITIVE(thread_count);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return fill_shared_table(NULL, table, filename, max_words, thread_count);
+}
+
+/**
+ * @brief Map file and count its words in one of shared tables by
+ * `thread_count` threads
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int fill_shared_table(ConcurrentHashTable* shared,
+                             LockFreeHashTable* lockfree,
+                             const char* filename, ssize_t max_words,
+                             size_t thread_count)
+{
+    const int input = open(filename, O_RDONLY);
+    struct stat input_stat = {};
+    if (input < 0 || fstat(input, &input_stat) < 0)
+    {
+        // TODO: Logs
+        if (input >= 0) close(input);
+        errno = EACCES;
+        return -1;
+    }
+
+    /* Shared tables are filled from mapping only, and pipes cannot be
+     * mapped or split between threads */
+    if (!S_ISREG(input_stat.st_mode))
+    {
+        // TODO: Logs
+        close(input);
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t word_count = (size_t) input_stat.st_size / max_word_length;
+    if (max_words >= 0 && (size_t) max_words < word_count)
+        word_count = (size_t) max_words;
+
+    if (word_count == 0)
+    {
+        close(input);
+        return 0;
+    }
+
+    void* mapping = mmap(NULL, word_count * max_word_length, PROT_READ,
+                         MAP_PRIVATE, input, 0);
+    close(input);
+
+    if (mapping == MAP_FAILED)
+    {
+        // TODO: Logs
+        errno = EACCES;
+        return -1;
+    }
+
+    const size_t worker_count = thread_count < word_count
+                              ? thread_count
+                              : word_count;
+    FillWorker* workers = create_workers((const char*) mapping,
+                                         word_count, worker_count);
+    if (!workers)
+    {
+        // TODO: Logs
+        munmap(mapping, word_count * max_word_length);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        workers[i].shared   = shared;
+        workers[i].lockfree = lockfree;
+    }
+
+    const int result = run_workers(workers, worker_count,
+                                   count_shared_words);
+    const int error = errno;
+
+    free(workers);
+    munmap(mapping, word_count * max_word_length);
+
+    errno = error;
+    return result;
+}
+
+/**
+ * @brief Allocate workers and split words between them
+ *
+ * @return Allocated workers, NULL upon error
+ */
+static FillWorker* create_workers(const char* text, size_t word_count,
+                                  size_t worker_count)
+{
+    FillWorker* workers = (FillWorker*) calloc(worker_count,
+                                               sizeof(*workers));
+    if (!workers)
+        return NULL;
+
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        const size_t first = word_count * i / worker_count;
+        const size_t last  = word_count * (i + 1) / worker_count;
+
+        workers[i].text = text + first * max_word_length;
+        workers[i].word_count = last - first;
+        workers[i].workers = workers;
+        workers[i].worker_count = worker_count;
+        workers[i].index = i;
+    }
+
+    return workers;
+}
+
+/**
+ * @brief Get partition of key. Partition is computed by its own hash
+ * function, as hashes of table are not exposed
+ */
+__always_inline
+static size_t get_partition(const char* key, size_t length,
+                            size_t partition_count)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t) key[i]) * 0x100000001b3;
+
+    return (size_t) (((unsigned __int128) hash * partition_count) >> 64);
+}
+
+/**
+ * @brief Count words of worker range in its own table
+ */
+static void* count_words(void* worker_ptr)
+{
+    FillWorker* worker = (FillWorker*) worker_ptr;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                hash_table_ctor(&worker->words, partial_table_bucket_count));
+        ASSERT_ZERO(
+                hash_table_set_max_load_factor(&worker->words,
+                                               worker->max_load_factor));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        worker->error = ENOMEM;
+        return NULL;
+    }
+    SAFE_BLOCK_END
+
+    const char* keys[key_batch_size] = {};
+
+    for (size_t i = 0; i < worker->word_count; i += key_batch_size)
+    {
+        const size_t batched = worker->word_count - i < key_batch_size
+                             ? worker->word_count - i
+                             : key_batch_size;
+        for (size_t j = 0; j < batched; ++j)
+            keys[j] = worker->text + (i + j) * max_word_length;
+
+        if (hash_table_key_increment_counter_batch(&worker->words,
+                                                   keys, batched) < 0)
+        {
+            // TODO: Logs
+            worker->error = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Count words of worker range in shared concurrent or lock-free
+ * table
+ */
+static void* count_shared_words(void* worker_ptr)
+{
+    FillWorker* worker = (FillWorker*) worker_ptr;
+
+    const char* keys[key_batch_size] = {};
+
+    for (size_t i = 0; i < worker->word_count; i += key_batch_size)
+    {
+        const size_t batched = worker->word_count - i < key_batch_size
+                             ? worker->word_count - i
+                             : key_batch_size;
+        for (size_t j = 0; j < batched; ++j)
+            keys[j] = worker->text + (i + j) * max_word_length;
+
+        const int result = worker->lockfree
+            ? lockfree_table_key_increment_counter_batch(worker->lockfree,
+                                                         keys, batched)
+            : concurrent_table_key_increment_counter_batch(worker->shared,
+                                                           keys, batched);
+        if (result < 0)
+        {
+            // TODO: Logs
+            worker->error = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Sort entries of worker table by partition. Each partition
+ * takes range `partition_starts[p]..partition_starts[p + 1]` of `entries`
+ */
+static void* split_partitions(void* worker_ptr)
+{
+    FillWorker* worker = (FillWorker*) worker_ptr;
+    const size_t partition_count = worker->worker_count;
+    const size_t entry_count = worker->words.distinct_count;
+
+    MergeEntry* unsorted = (MergeEntry*) calloc(entry_count + 1,
+                                                sizeof(*unsorted));
+    worker->entries = (MergeEntry*) calloc(entry_count + 1,
+                                           sizeof(*worker->entries));
+    worker->partition_starts = (size_t*) calloc(partition_count + 1,
+                                        sizeof(*worker->partition_starts));
+    if (!unsorted || !worker->entries || !worker->partition_starts)
+    {
+        // TODO: Logs
+        free(unsorted);
+        worker->error = ENOMEM;
+        return NULL;
+    }
+
+    HashTableIterator it = {};
+    if (hash_table_get_iterator(&worker->words, &it) < 0)
+    {
+        free(unsorted);
+        return NULL;
+    }
+
+    /* Iterator keys of full length are not zero-terminated in
+     * open-addressing engine */
+    size_t index = 0;
+    do
+    {
+        const size_t length = strnlen(it.key, max_word_length);
+        const size_t partition = get_partition(it.key, length,
+                                               partition_count);
+        unsorted[index++] = {
+            .key = it.key,
+            .length = length,
+            .count = it.count,
+            .partition = partition
+        };
+        ++ worker->partition_starts[partition + 1];
+    } while (hash_table_iterator_get_next(&it) == 0);
+
+    for (size_t p = 0; p < partition_count; ++p)
+        worker->partition_starts[p + 1] += worker->partition_starts[p];
+
+    size_t* const positions = worker->partition_starts;
+    for (size_t i = 0; i < index; ++i)
+        worker->entries[positions[unsorted[i].partition]++] = unsorted[i];
+
+    /* Placing entries advanced each start to the start of next partition */
+    for (size_t p = partition_count; p > 0; --p)
+        positions[p] = positions[p - 1];
+    positions[0] = 0;
+
+    free(unsorted);
+
+    return NULL;
+}
+
+/**
+ * @brief Sum counts of words of worker partition from all worker tables
+ */
+static void* merge_partition(void* worker_ptr)
+{
+    FillWorker* worker = (FillWorker*) worker_ptr;
+    const size_t partition = worker->index;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                hash_table_ctor(&worker->partition,
+                                partial_table_bucket_count));
+        ASSERT_ZERO(
+                hash_table_set_max_load_factor(&worker->partition,
+                                               worker->max_load_factor));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        worker->error = ENOMEM;
+        return NULL;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < worker->worker_count; ++i)
+    {
+        const FillWorker* source = &worker->workers[i];
+        const size_t first = source->partition_starts[partition];
+        const size_t last  = source->partition_starts[partition + 1];
+
+        for (size_t j = first; j < last; ++j)
+        {
+            const MergeEntry* entry = &source->entries[j];
+            if (hash_table_key_increase_counter_n(&worker->partition,
+                                                  entry->key, entry->length,
+                                                  entry->count) < 0)
+            {
+                // TODO: Logs
+                worker->error = ENOMEM;
+                return NULL;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Move merged partition of worker into result table
+ */
+static void* move_partition(void* worker_ptr)
+{
+    FillWorker* worker = (FillWorker*) worker_ptr;
+
+    if (hash_table_merge_source(worker->merge, worker->index) < 0)
+    {
+        // TODO: Logs
+        worker->error = errno;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Run routine for every worker in its own thread and wait for all
+ * of them
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int run_workers(FillWorker* workers, size_t worker_count,
+                       void* (*routine)(void*))
+{
+    pthread_t* threads = (pthread_t*) calloc(worker_count, sizeof(*threads));
+    if (!threads)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    /* Calling thread runs the first worker itself */
+    size_t started = 1;
+    for (; started < worker_count; ++started)
+        if (pthread_create(&threads[started], NULL,
+                           routine, &workers[started]) != 0)
+            break;
+
+    routine(&workers[0]);
+
+    for (size_t i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+
+    if (started < worker_count)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        if (workers[i].error)
+        {
+            // TODO: Logs
+            errno = workers[i].error;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Move merged partitions into table. Partitions contain distinct
+ * words, so each of them is moved into empty table by its own thread
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int merge_into_table(HashTable* table,
+                            FillWorker* workers, size_t worker_count)
+{
+    if (table->distinct_count)
+        return add_to_table(table, workers, worker_count);
+
+    HashTable** partitions = (HashTable**) calloc(worker_count,
+                                                  sizeof(*partitions));
+    if (!partitions)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < worker_count; ++i)
+        partitions[i] = &workers[i].partition;
+
+    HashTableMerge merge = {};
+    const int result = hash_table_merge_begin(&merge, table,
+                                              partitions, worker_count);
+    free(partitions);
+
+    if (result < 0)
+        return -1;
+
+    for (size_t i = 0; i < worker_count; ++i)
+        workers[i].merge = &merge;
+
+    /* Partitions, which were not moved because their threads failed to
+     * start, are moved by calling thread */
+    run_workers(workers, worker_count, move_partition);
+
+    return hash_table_merge_end(&merge);
+}
+
+/**
+ * @brief Add merged partitions to non-empty table. Words of partitions
+ * may be already present in it, so they are added one by one
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int add_to_table(HashTable* table,
+                        FillWorker* workers, size_t worker_count)
+{
+    size_t distinct_count = table->distinct_count;
+    for (size_t i = 0; i < worker_count; ++i)
+        distinct_count += workers[i].partition.distinct_count;
+
+    /* Reservation failures are not fatal: table grows instead */
+    hash_table_reserve(table, distinct_count);
+
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        HashTableIterator it = {};
+        if (hash_table_get_iterator(&workers[i].partition, &it) < 0)
+            continue;
+
+        do
+        {
+            const size_t length = strnlen(it.key, max_word_length);
+            if (hash_table_key_increase_counter_n(table, it.key, length,
+                                                  it.count) < 0)
+                return -1;
+        } while (hash_table_iterator_get_next(&it) == 0);
+    }
+
+    return 0;
+}
+
+static void destroy_workers(FillWorker* workers, size_t worker_count)
+{
+    /* Tables, which were not constructed after an error or were
+     * destroyed by merge, are zeroed and rejected by destructor */
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        hash_table_dtor(&workers[i].words);
+        hash_table_dtor(&workers[i].partition);
+        free(workers[i].entries);
+        free(workers[i].partition_starts);
+    }
+
+    free(workers);
+}
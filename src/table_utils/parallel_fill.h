@@ -0,0 +1,95 @@
+/**
+ * @file parallel_fill.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Filling hash table from file by several threads
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TABLE_UTILS_PARALLEL_FILL_H
+#define __TABLE_UTILS_PARALLEL_FILL_H
+
+#include <sys/types.h>
+
+#include "hash_table/hash_table.h"
+#include "hash_table/concurrent_table.h"
+#include "hash_table/lockfree_table.h"
+
+/**
+ * @brief Fill table with words from file, produced by `convert.py`, using
+ * several threads.
+ *
+ * File is split into equal ranges of words, and each thread counts words
+ * of its range in its own table. Thread tables are then merged: each
+ * thread collects counts of words from its hash partition, so that
+ * partitions are merged in parallel. Merged partitions are then moved
+ * into empty `table` by their threads, or added to non-empty `table` by
+ * calling thread.
+ *
+ * Small files and files which cannot be mapped to memory are read by
+ * `fill_hash_table()` in calling thread
+ *
+ * @param[inout] table		- Hash table to work with
+ * @param[in]    filename	- Path to text file
+ * @param[in] 	 max_words	- Maximum number of words to read from file.
+ *                              -1 means all words will be read.
+ * @param[in]    thread_count	- Maximum number of threads
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL or uninitialized of filename is NULL
+ * @exception ENOMEM    - not enough memory to store words in tables or to
+ *                          start threads
+ * @exception EACCES    - failed to open file
+ */
+int fill_hash_table_parallel(HashTable* table, const char* filename,
+                             ssize_t max_words, size_t thread_count);
+
+/**
+ * @brief Fill concurrent table with words from file, produced by
+ * `convert.py`. File is split into equal ranges of words, and all threads
+ * count words of their ranges in `table` directly
+ *
+ * @param[inout] table		- Concurrent table to work with
+ * @param[in]    filename	- Path to text file
+ * @param[in] 	 max_words	- Maximum number of words to read from file.
+ *                              -1 means all words will be read.
+ * @param[in]    thread_count	- Number of threads
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or filename is NULL, thread count is 0 or
+ *                          file is not a regular file
+ * @exception ENOMEM    - not enough memory to store words in table or to
+ *                          start threads
+ * @exception EACCES    - failed to open or map file
+ */
+int fill_concurrent_table(ConcurrentHashTable* table, const char* filename,
+                          ssize_t max_words, size_t thread_count);
+
+/**
+ * @brief Fill lock-free table with words from file, produced by
+ * `convert.py`. File is split into equal ranges of words, and all threads
+ * count words of their ranges in `table` directly
+ *
+ * @param[inout] table		- Lock-free table to work with
+ * @param[in]    filename	- Path to text file
+ * @param[in] 	 max_words	- Maximum number of words to read from file.
+ *                              -1 means all words will be read.
+ * @param[in]    thread_count	- Number of threads
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table or filename is NULL, thread count is 0 or
+ *                          file is not a regular file
+ * @exception ENOMEM    - not enough memory to store words in table or to
+ *                          start threads
+ * @exception EACCES    - failed to open or map file
+ */
+int fill_lockfree_table(LockFreeHashTable* table, const char* filename,
+                        ssize_t max_words, size_t thread_count);
+
+#endif /* parallel_fill.h */
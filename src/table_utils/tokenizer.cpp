@@ -0,0 +1,460 @@
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "tokenizer.h"
+
+/* Number of bytes classified at once */
+static const size_t block_size = 64;
+
+/**
+ * @brief Classes of bytes in block. i-th bit of each mask describes i-th
+ * byte of block
+ */
+struct ByteClasses
+{
+    uint64_t space;         /* ASCII whitespace */
+    uint64_t wide_space;    /* First byte of possible non-ASCII whitespace */
+    uint64_t letter;        /* ASCII letter */
+    uint64_t roman;         /* Uppercase Roman numeral */
+};
+
+enum WordStatus
+{
+    WORD_INCOMPLETE,
+    WORD_DROPPED,
+    WORD_EXTRACTED
+};
+
+static void classify_block(const char* bytes, ByteClasses* classes,
+                           char* lowered);
+static WordStatus extract_word(const uint8_t* text, size_t size,
+                               int is_final, size_t* position,
+                               PaddedKey* word);
+
+size_t tokenize_text(const char* text, size_t size, int is_final,
+                     PaddedKey* words, size_t max_words, size_t* word_count)
+{
+    PaddedKey tail = {};
+    PaddedKey lowered = {};
+
+    size_t position = 0;
+    size_t count = 0;
+
+    while (count < max_words && position < size)
+    {
+        const size_t available = size - position;
+        const char* block = text + position;
+        uint64_t valid = ~0ull;
+
+        /* Block must not be read past the end of text */
+        if (available < block_size)
+        {
+            memset(tail.data, 0, block_size);
+            memcpy(tail.data, block, available);
+            block = tail.data;
+            valid = (1ull << available) - 1;
+        }
+
+        ByteClasses classes = {};
+        classify_block(block, &classes, lowered.data);
+
+        const uint64_t word_bytes = ~classes.space & valid;
+        if (!word_bytes)
+        {
+            position += available < block_size ? available : block_size;
+            continue;
+        }
+
+        const size_t start = (size_t) __builtin_ctzll(word_bytes);
+        const uint64_t ends = (classes.space | classes.wide_space)
+                            & valid & (~0ull << start);
+
+        /* Word of ASCII letters, followed by ASCII whitespace, is taken
+         * from lowercased block as is */
+        if (ends)
+        {
+            const size_t end = (size_t) __builtin_ctzll(ends);
+            const uint64_t word_mask = ((1ull << end) - 1) & (~0ull << start);
+
+            if (end > start && (classes.space >> end & 1)
+                && (classes.letter & word_mask) == word_mask)
+            {
+                position += end;
+
+                if ((classes.roman & word_mask) == word_mask)
+                    continue;
+
+                char* word = words[count++].data;
+                memcpy(word, lowered.data + start, end - start);
+                memset(word + (end - start), 0,
+                       max_word_length - (end - start));
+                continue;
+            }
+        }
+
+        size_t word_end = position + start;
+        const WordStatus status = extract_word((const uint8_t*) text, size,
+                                               is_final, &word_end,
+                                               &words[count]);
+        position = word_end;
+
+        if (status == WORD_INCOMPLETE)
+            break;
+        if (status == WORD_EXTRACTED)
+            ++ count;
+    }
+
+    *word_count = count;
+    return position;
+}
+
+/* Code point, assigned to bytes of invalid UTF-8 sequences */
+static const uint32_t invalid_code_point = UINT32_MAX;
+
+__always_inline
+static int is_ascii_space(uint8_t c)
+{
+    return (c >= '\t' && c <= '\r') || (c >= 0x1C && c <= ' ');
+}
+
+/**
+ * @brief Check if code point is non-ASCII whitespace (as in Python
+ * `str.isspace()`)
+ */
+__always_inline
+static int is_wide_space(uint32_t code_point)
+{
+    return code_point == 0x85   || code_point == 0xA0
+        || code_point == 0x1680
+        || (code_point >= 0x2000 && code_point <= 0x200A)
+        || code_point == 0x2028 || code_point == 0x2029
+        || code_point == 0x202F || code_point == 0x205F
+        || code_point == 0x3000;
+}
+
+/**
+ * @brief Get lowercase form of letter from Latin-1 or Cyrillic range
+ *
+ * @return Lowercase code point, 0 if code point is not a letter
+ */
+__always_inline
+static uint32_t lower_wide_letter(uint32_t code_point)
+{
+    if (code_point < 0x100)
+    {
+        if (code_point == 0xAA || code_point == 0xB5 || code_point == 0xBA)
+            return code_point;
+        if (code_point < 0xC0 || code_point == 0xD7 || code_point == 0xF7)
+            return 0;
+        return code_point <= 0xDE ? code_point + 0x20 : code_point;
+    }
+
+    if (code_point < 0x400 || code_point > 0x4FF)
+        return 0;
+
+    /* Cyrillic signs and combining marks */
+    if (code_point >= 0x482 && code_point <= 0x489)
+        return 0;
+
+    if (code_point <= 0x40F) return code_point + 0x50;
+    if (code_point <= 0x42F) return code_point + 0x20;
+    if (code_point <= 0x45F) return code_point;
+    if (code_point == 0x4C0) return 0x4CF;
+
+    /* Remaining letters go in pairs of uppercase and lowercase, which are
+     * shifted by one in 0x4C1-0x4CE */
+    if (code_point >= 0x4C1 && code_point <= 0x4CE)
+        return code_point % 2 ? code_point + 1 : code_point;
+    return code_point % 2 ? code_point : code_point + 1;
+}
+
+/**
+ * @brief Decode UTF-8 sequence. Invalid sequence is decoded as a single
+ * byte with `invalid_code_point`
+ *
+ * @return Length of sequence, 0 if sequence is cut by the end of text
+ */
+static size_t decode_code_point(const uint8_t* text, size_t size,
+                                uint32_t* code_point)
+{
+    const uint8_t lead = text[0];
+    size_t length = 0;
+    uint8_t second_min = 0x80;
+    uint8_t second_max = 0xBF;
+
+    *code_point = invalid_code_point;
+
+    if      (lead >= 0xC2 && lead <= 0xDF) length = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF) length = 3;
+    else if (lead >= 0xF0 && lead <= 0xF4) length = 4;
+    else return 1;
+
+    /* Reject overlong forms, surrogates and code points past U+10FFFF */
+    if (lead == 0xE0) second_min = 0xA0;
+    if (lead == 0xED) second_max = 0x9F;
+    if (lead == 0xF0) second_min = 0x90;
+    if (lead == 0xF4) second_max = 0x8F;
+
+    uint32_t value = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; ++i)
+    {
+        if (i >= size)
+            return 0;
+
+        const uint8_t next = text[i];
+        if (next < (i == 1 ? second_min : 0x80)
+            || next > (i == 1 ? second_max : 0xBF))
+            return 1;
+
+        value = value << 6 | (next & 0x3F);
+    }
+
+    *code_point = value;
+    return length;
+}
+
+/**
+ * @brief Extract word, decoding it character by character. Whitespace
+ * preceding the word is skipped
+ *
+ * @param[inout] position   - Start of word. Upon return it is position
+ *                            after the word or, if word is incomplete,
+ *                            its first byte
+ */
+static WordStatus extract_word(const uint8_t* text, size_t size,
+                               int is_final, size_t* position,
+                               PaddedKey* word)
+{
+    size_t word_start = *position;
+    size_t pos = *position;
+    size_t length = 0;
+    int is_roman = 1;
+    int is_too_long = 0;
+
+    while (pos < size)
+    {
+        uint32_t code_point = text[pos];
+        size_t sequence = 1;
+
+        if (code_point >= 0x80)
+        {
+            sequence = decode_code_point(text + pos, size - pos, &code_point);
+            if (!sequence && !is_final)
+            {
+                *position = word_start;
+                return WORD_INCOMPLETE;
+            }
+            if (!sequence)
+                sequence = 1;
+        }
+
+        const int is_space = code_point < 0x80
+                                ? is_ascii_space((uint8_t) code_point)
+                                : is_wide_space(code_point);
+        if (is_space && pos == word_start)
+        {
+            pos += sequence;
+            word_start = pos;
+            continue;
+        }
+        if (is_space)
+            break;
+
+        pos += sequence;
+
+        uint32_t lower = 0;
+        if (code_point < 0x80)
+        {
+            const uint8_t c = (uint8_t) code_point;
+            if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+                lower = c | 0x20;
+        }
+        else
+            lower = lower_wide_letter(code_point);
+
+        /* Non-letters are removed before Roman numerals are checked */
+        if (!lower)
+            continue;
+
+        is_roman &= code_point == 'I' || code_point == 'L'
+                 || code_point == 'V' || code_point == 'X';
+
+        const size_t encoded = lower < 0x80 ? 1 : 2;
+        if (length + encoded > max_word_length)
+        {
+            is_too_long = 1;
+            continue;
+        }
+
+        if (encoded == 1)
+            word->data[length] = (char) lower;
+        else
+        {
+            word->data[length]     = (char) (0xC0 | lower >> 6);
+            word->data[length + 1] = (char) (0x80 | (lower & 0x3F));
+        }
+        length += encoded;
+    }
+
+    if (pos == size && !is_final && pos != word_start)
+    {
+        *position = word_start;
+        return WORD_INCOMPLETE;
+    }
+
+    *position = pos;
+
+    if (!length || is_roman || is_too_long)
+        return WORD_DROPPED;
+
+    memset(word->data + length, 0, max_word_length - length);
+    return WORD_EXTRACTED;
+}
+
+/*
+ * Block classification has versions for several instruction sets. GCC
+ * selects one of them when program is loaded.
+ */
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline uint64_t in_range_512(__m512i vec, uint8_t low, uint8_t high)
+{
+    return _mm512_cmple_epu8_mask(
+                        _mm512_sub_epi8(vec, _mm512_set1_epi8((char) low)),
+                        _mm512_set1_epi8((char) (high - low)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void classify_block_impl(const char* bytes, ByteClasses* classes,
+                                char* lowered)
+{
+    const __m512i vec = _mm512_loadu_si512(bytes);
+
+    const uint64_t upper = in_range_512(vec, 'A', 'Z');
+
+    classes->space      = in_range_512(vec, '\t', '\r')
+                        | in_range_512(vec, 0x1C, ' ');
+    classes->wide_space = in_range_512(vec, 0xC2, 0xC2)
+                        | in_range_512(vec, 0xE1, 0xE3);
+    classes->letter     = upper | in_range_512(vec, 'a', 'z');
+    classes->roman      = in_range_512(vec, 'I', 'I')
+                        | in_range_512(vec, 'L', 'L')
+                        | in_range_512(vec, 'V', 'V')
+                        | in_range_512(vec, 'X', 'X');
+
+    _mm512_store_si512(lowered, _mm512_mask_blend_epi8(upper, vec,
+                    _mm512_or_si512(vec, _mm512_set1_epi8(0x20))));
+}
+
+/**
+ * @brief Vector with bytes set to 0xFF where byte of `vec` lies
+ * in [low, high]
+ */
+__attribute__((target("avx2"), always_inline))
+static inline __m256i in_range_256(__m256i vec, uint8_t low, uint8_t high)
+{
+    const __m256i shifted = _mm256_sub_epi8(vec, _mm256_set1_epi8((char) low));
+    return _mm256_cmpeq_epi8(shifted, _mm256_min_epu8(shifted,
+                                _mm256_set1_epi8((char) (high - low))));
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline uint64_t to_mask_256(__m256i vec)
+{
+    return (uint32_t) _mm256_movemask_epi8(vec);
+}
+
+__attribute__((target("avx2")))
+static void classify_block_impl(const char* bytes, ByteClasses* classes,
+                                char* lowered)
+{
+    *classes = {};
+
+    for (size_t i = 0; i < block_size; i += sizeof(__m256i))
+    {
+        const __m256i vec = _mm256_loadu_si256((const __m256i*) (bytes + i));
+        const __m256i upper = in_range_256(vec, 'A', 'Z');
+
+        classes->space      |= to_mask_256(_mm256_or_si256(
+                                    in_range_256(vec, '\t', '\r'),
+                                    in_range_256(vec, 0x1C, ' '))) << i;
+        classes->wide_space |= to_mask_256(_mm256_or_si256(
+                                    in_range_256(vec, 0xC2, 0xC2),
+                                    in_range_256(vec, 0xE1, 0xE3))) << i;
+        classes->letter     |= to_mask_256(_mm256_or_si256(upper,
+                                    in_range_256(vec, 'a', 'z'))) << i;
+        classes->roman      |= to_mask_256(_mm256_or_si256(
+                                _mm256_or_si256(in_range_256(vec, 'I', 'I'),
+                                                in_range_256(vec, 'L', 'L')),
+                                _mm256_or_si256(in_range_256(vec, 'V', 'V'),
+                                                in_range_256(vec, 'X', 'X'))))
+                                << i;
+
+        _mm256_store_si256((__m256i*) (lowered + i), _mm256_or_si256(vec,
+                        _mm256_and_si256(upper, _mm256_set1_epi8(0x20))));
+    }
+}
+
+/**
+ * @brief Vector with bytes set to 0xFF where byte of `vec` lies
+ * in [low, high]
+ */
+__always_inline
+static __m128i in_range_128(__m128i vec, uint8_t low, uint8_t high)
+{
+    const __m128i shifted = _mm_sub_epi8(vec, _mm_set1_epi8((char) low));
+    return _mm_cmpeq_epi8(shifted, _mm_min_epu8(shifted,
+                                _mm_set1_epi8((char) (high - low))));
+}
+
+__always_inline
+static uint64_t to_mask_128(__m128i vec)
+{
+    return (uint16_t) _mm_movemask_epi8(vec);
+}
+
+__attribute__((target("default")))
+static void classify_block_impl(const char* bytes, ByteClasses* classes,
+                                char* lowered)
+{
+    *classes = {};
+
+    for (size_t i = 0; i < block_size; i += sizeof(__m128i))
+    {
+        const __m128i vec = _mm_loadu_si128((const __m128i*) (bytes + i));
+        const __m128i upper = in_range_128(vec, 'A', 'Z');
+
+        classes->space      |= to_mask_128(_mm_or_si128(
+                                    in_range_128(vec, '\t', '\r'),
+                                    in_range_128(vec, 0x1C, ' '))) << i;
+        classes->wide_space |= to_mask_128(_mm_or_si128(
+                                    in_range_128(vec, 0xC2, 0xC2),
+                                    in_range_128(vec, 0xE1, 0xE3))) << i;
+        classes->letter     |= to_mask_128(_mm_or_si128(upper,
+                                    in_range_128(vec, 'a', 'z'))) << i;
+        classes->roman      |= to_mask_128(_mm_or_si128(
+                                    _mm_or_si128(in_range_128(vec, 'I', 'I'),
+                                                 in_range_128(vec, 'L', 'L')),
+                                    _mm_or_si128(in_range_128(vec, 'V', 'V'),
+                                                 in_range_128(vec, 'X', 'X'))))
+                                << i;
+
+        _mm_store_si128((__m128i*) (lowered + i), _mm_or_si128(vec,
+                        _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+    }
+}
+
+/**
+ * @brief Find classes of 64 bytes and lowercase ASCII letters among them
+ *
+ * @param[in]  bytes	- Block of `block_size` bytes
+ * @param[out] classes	- Byte classes
+ * @param[out] lowered	- Block with lowercased ASCII letters, aligned
+ *                        to `block_size`
+ */
+static void classify_block(const char* bytes, ByteClasses* classes,
+                           char* lowered)
+{
+    classify_block_impl(bytes, classes, lowered);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file tokenizer.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Extraction of words from raw UTF-8 text. Produces the same words
+ * as `convert.py`, already padded for hash table
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TABLE_UTILS_TOKENIZER_H
+#define __TABLE_UTILS_TOKENIZER_H
+
+#include <stddef.h>
+
+#include "hash_table/hash_table.h"
+
+/**
+ * @brief Extract words from text. Text is split at whitespace, characters
+ * other than letters are removed from each part, parts consisting only of
+ * uppercase Roman numerals (I, L, V, X) are dropped and the rest are
+ * lowercased.
+ *
+ * Letters are recognized and lowercased in ASCII, Latin-1 and Cyrillic
+ * ranges, all other non-ASCII characters are removed. Words, which take
+ * more than `max_word_length` bytes, are dropped
+ *
+ * @param[in]  text	    - Text in UTF-8
+ * @param[in]  size	    - Size of text in bytes
+ * @param[in]  is_final	    - 1 if text is not followed by more data.
+ *                            Otherwise the last word is not extracted, as
+ *                            it may continue past the end of text
+ * @param[out] words	    - Extracted words
+ * @param[in]  max_words    - Maximum number of words to extract
+ * @param[out] word_count   - Number of extracted words
+ *
+ * @return Number of bytes of text processed. Unprocessed bytes must be
+ * passed to next call, followed by more text
+ */
+size_t tokenize_text(const char* text, size_t size, int is_final,
+                     PaddedKey* words, size_t max_words, size_t* word_count);
+
+#endif /* tokenizer.h */
@@ -2,6 +2,7 @@
 #include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -9,20 +10,372 @@
 
 #include "meerkat_assert/asserts.h"
 
+#include "async_reader.h"
+#include "tokenizer.h"
 #include "utils.h"
 
+/* Number of keys passed to hash table in one batch call */
+static const size_t key_batch_size = 64;
+
+/* Size of buffer for inputs, which cannot be mapped to memory */
+static const size_t read_buffer_size = 1 << 16;
+
+/* Number of words read before estimating distinct word count of file */
+static const size_t distinct_sample_size = 1 << 16;
+
+/* Headroom added to estimated distinct word count */
+static const double distinct_estimate_margin = 1.25;
+
+/* Size of buffer for raw text. Sequences of non-whitespace characters
+ * longer than it are split into several words */
+static const size_t text_buffer_size = 1 << 20;
+
+static size_t estimate_distinct_words(size_t sample1, size_t distinct1,
+                                      size_t sample2, size_t distinct2,
+                                      size_t total);
+
 __always_inline
 static int is_word_char(const char c)
 {
     return !isspace(c) && !ispunct(c) && !isdigit(c);
 }
 
+/**
+ * @brief State of table filling, shared by mapped and buffered input
+ */
+struct FillState
+{
+    HashTable* table;
+    ssize_t max_words;
+    size_t words_bound;
+    size_t initial_distinct;
+
+    size_t half_sample_words;
+    size_t half_sample_distinct;
+    int estimated;
+
+    size_t words_cnt;
+};
+
+static void fill_state_init(FillState* state, HashTable* table,
+                            size_t words_bound, ssize_t max_words);
+static int fill_state_add_words(FillState* state,
+                                const char* data, size_t size);
+static int fill_from_mapping(FillState* state, int input, size_t size);
+static int fill_from_async_reads(FillState* state, const char* filename,
+                                 size_t size);
+static int fill_from_reads(FillState* state, int input);
+
 int fill_hash_table(HashTable* table, const char* filename, ssize_t max_words)
 {
     SAFE_BLOCK_START
     {
         ASSERT_TRUE(table != NULL);
-        ASSERT_TRUE(table->buckets != NULL);
+        ASSERT_TRUE(filename);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const int input = open(filename, O_RDONLY);
+    if (input < 0)
+    {
+        // TODO: Logs
+        errno = EACCES;
+        return -1;
+    }
+
+    /* Every word takes exactly `max_word_length` bytes, so file size gives
+     * upper bound on word count */
+    struct stat input_stat = {};
+    const int has_size = fstat(input, &input_stat) == 0
+                      && S_ISREG(input_stat.st_mode);
+    size_t words_bound = has_size
+                        ? (size_t) input_stat.st_size / max_word_length
+                        : distinct_sample_size;
+    if (max_words >= 0 && (size_t) max_words < words_bound)
+        words_bound = (size_t) max_words;
+
+    FillState state = {};
+    fill_state_init(&state, table, words_bound, max_words);
+
+    /* Cached regular files are mapped. Files, which are not cached, are
+     * read asynchronously, so that reading overlaps with hashing. Other
+     * inputs, such as pipes, are read into buffer */
+    const size_t size = words_bound * max_word_length;
+    int result = has_size ? fill_from_mapping(&state, input, size) : 1;
+    if (result > 0 && has_size)
+        result = fill_from_async_reads(&state, filename, size);
+    if (result > 0)
+        result = fill_from_reads(&state, input);
+
+    close(input);
+
+    return result;
+}
+
+/**
+ * @brief Initialize filling state and pre-size table for first words
+ */
+static void fill_state_init(FillState* state, HashTable* table,
+                            size_t words_bound, ssize_t max_words)
+{
+    state->table = table;
+    state->max_words = max_words;
+    state->words_bound = words_bound;
+    state->initial_distinct = table->distinct_count;
+    state->estimated = words_bound <= distinct_sample_size;
+
+    /* Reservation failures are not fatal: table grows instead */
+    hash_table_reserve(table, state->initial_distinct +
+                    (words_bound < distinct_sample_size
+                        ? words_bound
+                        : distinct_sample_size));
+}
+
+/**
+ * @brief Add complete words from data to table. Once enough words are
+ * added, table is reserved for estimated distinct word count of file
+ *
+ * @return 1 if word limit is reached, 0 otherwise
+ */
+static int fill_state_add_words(FillState* state,
+                                const char* data, size_t size)
+{
+    size_t word_count = size / max_word_length;
+    int limit_reached = 0;
+
+    if (state->max_words >= 0 &&
+        state->words_cnt + word_count >= (size_t) state->max_words)
+    {
+        word_count = (size_t) state->max_words - state->words_cnt;
+        limit_reached = 1;
+    }
+
+    const char* words[key_batch_size] = {};
+
+    for (size_t i = 0; i < word_count; i += key_batch_size)
+    {
+        const size_t batched = word_count - i < key_batch_size
+                             ? word_count - i
+                             : key_batch_size;
+        for (size_t j = 0; j < batched; ++j)
+            words[j] = data + (i + j) * max_word_length;
+
+        hash_table_key_increment_counter_batch(state->table, words, batched);
+        state->words_cnt += batched;
+
+        if (state->estimated)
+            continue;
+
+        const size_t distinct = state->table->distinct_count
+                              - state->initial_distinct;
+
+        if (!state->half_sample_words &&
+            state->words_cnt >= distinct_sample_size/2)
+        {
+            state->half_sample_words = state->words_cnt;
+            state->half_sample_distinct = distinct;
+        }
+
+        if (state->words_cnt >= distinct_sample_size)
+        {
+            state->estimated = 1;
+            hash_table_reserve(state->table, state->initial_distinct +
+                    estimate_distinct_words(
+                            state->half_sample_words,
+                            state->half_sample_distinct,
+                            state->words_cnt, distinct,
+                            state->words_bound));
+        }
+    }
+
+    return limit_reached;
+}
+
+/**
+ * @brief Check whether all pages of mapping are in page cache
+ */
+static int is_mapping_cached(void* mapping, size_t size)
+{
+    const size_t page_size = (size_t) sysconf(_SC_PAGE_SIZE);
+    const size_t page_count = (size + page_size - 1) / page_size;
+
+    unsigned char* residency = (unsigned char*) malloc(page_count);
+    if (!residency)
+        return 0;
+
+    int cached = mincore(mapping, size, residency) == 0;
+    for (size_t i = 0; cached && i < page_count; ++i)
+        cached = residency[i] & 1;
+
+    free(residency);
+    return cached;
+}
+
+/**
+ * @brief Map `size` bytes of file and pass words to table directly from
+ * mapping. Mapping is page-aligned, so every word in it is aligned to
+ * `max_word_length` as required by table
+ *
+ * @return 0 upon success, 1 if file cannot be mapped or is not cached
+ */
+static int fill_from_mapping(FillState* state, int input, size_t size)
+{
+    if (size == 0)
+        return 0;
+
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, input, 0);
+    if (mapping == MAP_FAILED)
+        return 1;
+
+    /* Faulting in pages of uncached file blocks hashing on disk reads */
+    if (!is_mapping_cached(mapping, size))
+    {
+        munmap(mapping, size);
+        return 1;
+    }
+
+    /* Populating mapping up front replaces one page fault per page with
+     * single call. All advice is a hint, failures are harmless */
+    madvise(mapping, size, MADV_POPULATE_READ);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_HUGEPAGE);
+
+    fill_state_add_words(state, (const char*) mapping, size);
+
+    munmap(mapping, size);
+
+    return 0;
+}
+
+/**
+ * @brief Read `size` bytes of file with asynchronous reader, adding words
+ * from each block while next blocks are being read
+ *
+ * @return 0 upon success, -1 upon error, 1 if reader cannot be opened
+ */
+static int fill_from_async_reads(FillState* state, const char* filename,
+                                 size_t size)
+{
+    AsyncReader reader = {};
+    if (async_reader_open(&reader, filename, size) < 0)
+        return 1;
+
+    const char* data = NULL;
+    ssize_t read_result = 0;
+
+    /* Blocks hold whole number of words, except for the last one */
+    while ((read_result = async_reader_next(&reader, &data)) > 0)
+        if (fill_state_add_words(state, data, (size_t) read_result))
+            break;
+
+    async_reader_close(&reader);
+
+    if (read_result < 0)
+    {
+        // TODO: Logs
+        errno = EACCES;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Read words from file into buffer. Used for inputs which cannot be
+ * mapped. Reads may end in the middle of word, such partial words are
+ * completed by the next read
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int fill_from_reads(FillState* state, int input)
+{
+    char* text = NULL;
+    if (posix_memalign((void**) &text, max_word_length, read_buffer_size))
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t filled = 0;
+    int result = 0;
+
+    while (1)
+    {
+        const ssize_t read_result = read(input, text + filled,
+                                         read_buffer_size - filled);
+        if (read_result < 0)
+        {
+            // TODO: Logs
+            errno = EACCES;
+            result = -1;
+            break;
+        }
+        if (read_result == 0)
+            break;
+
+        filled += (size_t) read_result;
+
+        const size_t complete = filled - filled % max_word_length;
+        if (fill_state_add_words(state, text, complete))
+            break;
+
+        memmove(text, text + complete, filled - complete);
+        filled -= complete;
+    }
+
+    free(text);
+
+    return result;
+}
+
+/**
+ * @brief Extrapolate number of distinct words using Heaps' law
+ * `distinct = K * words^beta`. Exponent is fitted to two sample points
+ */
+static size_t estimate_distinct_words(size_t sample1, size_t distinct1,
+                                      size_t sample2, size_t distinct2,
+                                      size_t total)
+{
+    double beta = 1;
+    if (distinct1 && sample1 < sample2)
+        beta = log((double) distinct2 / (double) distinct1)
+             / log((double) sample2   / (double) sample1);
+
+    if (beta < 0) beta = 0;
+    if (beta > 1) beta = 1;
+
+    const double estimate = (double) distinct2 * distinct_estimate_margin
+                          * pow((double) total / (double) sample2, beta);
+
+    return estimate < (double) total ? (size_t) estimate : total;
+}
+
+/**
+ * @brief Copy iterator key into buffer, padding it with zeros. Iterator
+ * keys are not necessarily padded, while lookups require padded keys
+ *
+ * @return Padded key
+ */
+__always_inline
+static const char* pad_key(PaddedKey* buffer, const char* key)
+{
+    strncpy(buffer->data, key, max_word_length);
+    return buffer->data;
+}
+
+int fill_hash_table_from_text(HashTable* table, const char* filename,
+                              ssize_t max_words)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(table != NULL);
         ASSERT_TRUE(filename);
     }
     SAFE_BLOCK_HANDLE_ERRORS
@@ -34,7 +387,6 @@ int fill_hash_table(HashTable* table, const char* filename, ssize_t max_words)
     SAFE_BLOCK_END
 
     int fd = 0;
-    const size_t buffer_size = (size_t) sysconf(_SC_PAGE_SIZE);
     char* buffer = NULL;
 
     SAFE_BLOCK_START
@@ -42,15 +394,15 @@ int fill_hash_table(HashTable* table, const char* filename, ssize_t max_words)
         ASSERT_POSITIVE_CALLBACK(
                 fd = open(filename, O_RDONLY),
                 errno = EACCES);
-        ASSERT_ZERO_CALLBACK(
-                posix_memalign((void**)&buffer,
-                                max_word_length, sizeof(*buffer)*buffer_size),
+        ASSERT_CALLBACK(
+                buffer = (char*) malloc(text_buffer_size),
+                action_result != NULL,
                 errno = ENOMEM);
-        memset(buffer, 0, sizeof(*buffer)*buffer_size);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
         // TODO: Logs
+        if (fd > 0) close(fd);
         return -1;
     }
     SAFE_BLOCK_END
@@ -58,36 +410,63 @@ int fill_hash_table(HashTable* table, const char* filename, ssize_t max_words)
     const int input = fd;
     char* const text = buffer;
 
-    ssize_t read_result = 0;
-    ssize_t words_cnt = 0;
+    PaddedKey words[key_batch_size] = {};
+    const char* keys[key_batch_size] = {};
+    for (size_t i = 0; i < key_batch_size; ++i)
+        keys[i] = words[i].data;
+
+    size_t filled = 0;
+    size_t words_cnt = 0;
+    int at_end = 0;
+    int limit_reached = 0;
+    int result = 0;
 
-    while ((read_result = read(input, text, buffer_size)))
+    while (!at_end && !limit_reached)
     {
+        const ssize_t read_result = read(input, text + filled,
+                                         text_buffer_size - filled);
         if (read_result < 0)
         {
             // TODO: Logs
             errno = EACCES;
-            return -1;
+            result = -1;
+            break;
         }
 
-        const size_t bytes_available = (size_t) read_result;
+        filled += (size_t) read_result;
+        at_end = read_result == 0;
 
-        for (size_t i = 0;
-             i + max_word_length <= bytes_available;
-             i += max_word_length)
+        size_t processed = 0;
+        size_t extracted = 0;
+        do
         {
-            if (max_words >= 0 && words_cnt >= max_words)
-                goto end;
-            hash_table_key_increment_counter(table, text + i);
-            ++ words_cnt;
-        }
+            processed += tokenize_text(text + processed, filled - processed,
+                                       at_end, words, key_batch_size,
+                                       &extracted);
+
+            /* Buffer filled with one unfinished word is processed as is */
+            if (!processed && !extracted && filled == text_buffer_size)
+                processed = tokenize_text(text, filled, 1,
+                                          words, key_batch_size, &extracted);
+
+            if (max_words >= 0 && words_cnt + extracted >= (size_t) max_words)
+            {
+                extracted = (size_t) max_words - words_cnt;
+                limit_reached = 1;
+            }
+
+            hash_table_key_increment_counter_batch(table, keys, extracted);
+            words_cnt += extracted;
+        } while (extracted == key_batch_size && !limit_reached);
+
+        memmove(text, text + processed, filled - processed);
+        filled -= processed;
     }
 
-end:
     close(input);
     free(text);
 
-    return 0;
+    return result;
 }
 
 ssize_t get_table_diff(const HashTable* source, const HashTable* words,
@@ -99,17 +478,36 @@ ssize_t get_table_diff(const HashTable* source, const HashTable* words,
     if (hash_table_get_iterator(source, &it) < 0)
         return 0;
 
-    do
+    PaddedKey padded[key_batch_size] = {};
+    const char* keys[key_batch_size] = {};
+    const char* padded_keys[key_batch_size] = {};
+    size_t counts[key_batch_size] = {};
+    int has_next = 1;
+
+    while (has_next)
     {
-        const size_t count = hash_table_get_key_count(words, it.key);
-        if (count) continue;
+        size_t batched = 0;
+        do
+        {
+            keys[batched] = it.key;
+            padded_keys[batched] = pad_key(&padded[batched], it.key);
+            ++ batched;
+            has_next = hash_table_iterator_get_next(&it) == 0;
+        } while (has_next && batched < key_batch_size);
 
-        if (result_buffer && stored < buffer_size)
-            result_buffer[stored] = it.key;
-        else if (result_buffer)
-            return -1;
-        stored++;
-    } while (hash_table_iterator_get_next(&it) == 0);
+        hash_table_get_key_count_batch(words, padded_keys, batched, counts);
+
+        for (size_t i = 0; i < batched; ++i)
+        {
+            if (counts[i]) continue;
+
+            if (result_buffer && stored < buffer_size)
+                result_buffer[stored] = keys[i];
+            else if (result_buffer)
+                return -1;
+            stored++;
+        }
+    }
 
     return (ssize_t) stored;
 }
@@ -125,15 +523,32 @@ double get_cosine_similarity(const HashTable* src1, const HashTable* src2)
     if (hash_table_get_iterator(src1, &it) < 0)
         return 0;
 
-    do
+    PaddedKey padded[key_batch_size] = {};
+    const char* keys[key_batch_size] = {};
+    size_t counts1[key_batch_size] = {};
+    size_t counts2[key_batch_size] = {};
+    int has_next = 1;
+
+    while (has_next)
     {
-        const size_t count = hash_table_get_key_count(src2, it.key);
+        size_t batched = 0;
+        do
+        {
+            keys[batched] = pad_key(&padded[batched], it.key);
+            counts1[batched] = it.count;
+            ++ batched;
+            has_next = hash_table_iterator_get_next(&it) == 0;
+        } while (has_next && batched < key_batch_size);
 
-        len1 += (double)it.count * (double)it.count;
-        if (count)
-            dot_product += (double)it.count * (double)count;
+        hash_table_get_key_count_batch(src2, keys, batched, counts2);
 
-    } while (hash_table_iterator_get_next(&it) == 0);
+        for (size_t i = 0; i < batched; ++i)
+        {
+            len1 += (double)counts1[i] * (double)counts1[i];
+            if (counts2[i])
+                dot_product += (double)counts1[i] * (double)counts2[i];
+        }
+    }
 
     len1 = sqrt(len1);
     double len2 = get_vector_length(src2);
@@ -15,7 +15,13 @@
 #include "hash_table/hash_table.h"
 
 /**
- * @brief Fill table with words from file
+ * @brief Fill table with words from file. Table is pre-sized using file
+ * size and distinct word count estimated from first words read.
+ *
+ * Cached regular files are mapped to memory and words are passed to table
+ * without copying. Regular files, which are not cached, are read
+ * asynchronously, overlapping reads with hashing. Other files, such as
+ * pipes, are read into buffer
  *
  * @param[inout] table	    - Hash table to work with
  * @param[in]    filename   - Path to text file
@@ -31,6 +37,25 @@
  */
 int fill_hash_table(HashTable* table, const char* filename, ssize_t max_words);
 
+/**
+ * @brief Fill table with words from raw UTF-8 text file. Words are
+ * extracted the same way as `convert.py` does
+ *
+ * @param[inout] table	    - Hash table to work with
+ * @param[in]    filename   - Path to text file
+ * @param[in] 	 max_words  - Maximum number of words to read from file.
+ *                              -1 means all words will be read.
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - table is NULL or uninitialized of filename is NULL
+ * @exception ENOMEM    - not enough memory to store words in table
+ *                          or not enough memory for buffered input
+ * @exception EACCES    - failed to open or read file
+ */
+int fill_hash_table_from_text(HashTable* table, const char* filename,
+                              ssize_t max_words);
+
 /**
  * @brief Find all words in `source`, which are NOT in `words` and
  * store them in `result_buffer`
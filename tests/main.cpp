@@ -6,6 +6,9 @@
 #include "test_utils/config.h"
 #include "test_cases/histogram.h"
 #include "test_cases/benchmark.h"
+#include "test_cases/scaling.h"
+#include "test_cases/growth.h"
+#include "test_cases/tokenization.h"
 
 int main(int argc, char** argv)
 {
@@ -27,6 +30,12 @@ int main(int argc, char** argv)
         return run_test_histogram(argc, argv, &config);
     case TEST_BENCHMARK_FULL:
         return run_test_benchmark(argc, argv, &config);
+    case TEST_SCALING:
+        return run_test_scaling(argc, argv, &config);
+    case TEST_GROWTH:
+        return run_test_growth(argc, argv, &config);
+    case TEST_TOKENIZATION:
+        return run_test_tokenization(argc, argv, &config);
     case TEST_NONE:
     default:
         fprintf(stderr, "Invalid test case");
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "hash_table/hash_table.h"
+
+#include "growth.h"
+
+static int check_factor(double factor, const PaddedKey* keys,
+                        size_t key_count);
+
+static int check_counts(const HashTable* table, const PaddedKey* keys,
+                        size_t key_count, size_t removed);
+
+int run_test_growth(int argc, const char* const* argv,
+                    const TestConfig* config)
+{
+    /* Small factors used to make open-addressing table rehash in place
+     * forever, instead of growing */
+    static const double factors[] = {
+        0.05, 0.1, 0.3, 0.4, 0.45, 0.5, 0.75, 0.875
+    };
+
+    GrowthConfig params = {-1};
+    FILE* output = NULL;
+    PaddedKey* keys = NULL;
+
+    int parsed = parse_args(argc, argv, &GROWTH_ARGS, &params);
+    if (params.key_count < 0)
+        params.key_count = 10000;
+
+    const size_t key_count = (size_t) params.key_count;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL_MESSAGE(
+            parsed, argc, "Invalid arguments");
+        ASSERT_MESSAGE(
+            keys = (PaddedKey*) aligned_alloc(alignof(PaddedKey),
+                                              key_count * sizeof(*keys)),
+            action_result != NULL,
+            "Failed to allocate keys");
+
+        if (config->filename)
+        {
+            ASSERT_MESSAGE(
+                output = fopen(config->filename,
+                                config->append_to_file ? "a" : "w"),
+                action_result != NULL,
+                "Failed to open output file");
+        }
+        else output = stdout;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fprintf(stderr, "Error: %s\n", assertion_info.message);
+        free(keys);
+        return 1;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < key_count; ++i)
+    {
+        memset(keys[i].data, 0, sizeof(keys[i].data));
+        snprintf(keys[i].data, sizeof(keys[i].data), "key-%zu", i);
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < sizeof(factors) / sizeof(*factors); ++i)
+    {
+        const int factor_result = check_factor(factors[i], keys, key_count);
+
+        fprintf(output, "Load factor %-8lg %s\n", factors[i],
+                        factor_result ? "FAILED" : "OK");
+        if (factor_result)
+            result = 1;
+    }
+
+    if (output != stdout)
+        fclose(output);
+    free(keys);
+
+    return result;
+}
+
+int growth_next_arg(const char* const* str, void* params)
+{
+    GrowthConfig* config = (GrowthConfig*) params;
+
+    char* end = NULL;
+    long number = strtol(*str, &end, 10);
+
+    if (*end != '\0' || number <= 0 || config->key_count >= 0)
+    {
+        fprintf(stderr, "Error: '%s' is not a valid number\n", *str);
+        return -1;
+    }
+
+    config->key_count = number;
+    return 1;
+}
+
+/**
+ * @brief Count i-th key i % 3 + 1 times, remove every second key and
+ * count removed keys again in table with given maximum load factor
+ *
+ * @return 0 if all counts are correct, -1 otherwise
+ */
+static int check_factor(double factor, const PaddedKey* keys,
+                        size_t key_count)
+{
+    HashTable table = {};
+    int result = 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+            hash_table_ctor(&table, 16));
+        ASSERT_ZERO(
+            hash_table_set_max_load_factor(&table, factor));
+
+        for (size_t i = 0; i < key_count; ++i)
+            for (size_t j = 0; j <= i % 3; ++j)
+                ASSERT_ZERO(
+                    hash_table_key_increment_counter(&table, keys[i].data));
+        ASSERT_ZERO(
+            check_counts(&table, keys, key_count, 0));
+
+        /* Removed keys leave tombstones in open-addressing table */
+        for (size_t i = 0; i < key_count; i += 2)
+            for (size_t j = 0; j <= i % 3; ++j)
+                ASSERT_ZERO(
+                    hash_table_key_decrement_counter(&table, keys[i].data));
+        ASSERT_ZERO(
+            check_counts(&table, keys, key_count, 1));
+
+        for (size_t i = 0; i < key_count; i += 2)
+            for (size_t j = 0; j <= i % 3; ++j)
+                ASSERT_ZERO(
+                    hash_table_key_increment_counter(&table, keys[i].data));
+        ASSERT_ZERO(
+            check_counts(&table, keys, key_count, 0));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        result = -1;
+    }
+    SAFE_BLOCK_END
+
+    hash_table_dtor(&table);
+    return result;
+}
+
+/**
+ * @brief Check counts of keys, with every second one removed if `removed`
+ * is non-zero
+ *
+ * @return 0 if all counts are correct, -1 otherwise
+ */
+static int check_counts(const HashTable* table, const PaddedKey* keys,
+                        size_t key_count, size_t removed)
+{
+    size_t distinct = 0;
+    size_t total = 0;
+
+    for (size_t i = 0; i < key_count; ++i)
+    {
+        const size_t expected = removed && i % 2 == 0 ? 0 : i % 3 + 1;
+
+        if (hash_table_get_key_count(table, keys[i].data) != expected)
+            return -1;
+
+        distinct += expected != 0;
+        total    += expected;
+    }
+
+    if (table->distinct_count != distinct || table->total_count != total)
+        return -1;
+
+    return 0;
+}
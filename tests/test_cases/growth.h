@@ -0,0 +1,60 @@
+/**
+ * @file growth.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ * 
+ * @brief
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TESTS_TEST_CASES_GROWTH_H
+#define __TESTS_TEST_CASES_GROWTH_H
+
+#include <stddef.h>
+
+#include "meerkat_args/argparser.h"
+
+#include "test_utils/config.h"
+
+struct GrowthConfig
+{
+    ssize_t key_count;
+};
+
+/**
+ * @brief Insert, remove and insert again distinct keys into tables with
+ * different maximum load factors, including small ones, and check counts
+ * of all keys after each step
+ *
+ * @param[in] argc	    - Argument vector length
+ * @param[in] argv	    - Argument vector
+ * @param[in] config	- Test configuration
+ *
+ * @return Exit status
+ */
+int run_test_growth(int argc, const char* const* argv,
+                    const TestConfig* config);
+
+/**
+ * @brief Load next test argument
+ *
+ * @param[in]    str    Parameter array
+ * @param[inout] params GrowthConfig instance
+ *
+ * @return 1 upon success, -1 otherwise
+ */
+int growth_next_arg(const char* const* str, void* params);
+
+const arg_info GROWTH_ARGS = {
+    .help_message = 
+        "growth [KEY COUNT] - Count KEY COUNT distinct keys (10000 by "
+            "default) in tables with maximum load factors from 0.05 to 0.875",
+    .name_handler = NULL,
+    .plain_handler = growth_next_arg,
+    .tags = NULL,
+    .tag_cnt = 0
+};
+
+#endif /* growth.h */
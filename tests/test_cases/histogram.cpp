@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "meerkat_assert/asserts.h"
 
@@ -8,7 +9,9 @@
 
 #include "histogram.h"
 
-static void dump_contents(FILE* output, const HashTable* table);
+static void dump_contents(FILE* output, const HashTable* table,
+                          const char* reducer);
+static int parse_reducer(const char* name, HashTableReducer* reducer);
 
 #define STR(x) __BASIC_STR(x)
 #define __BASIC_STR(x) #x
@@ -16,9 +19,10 @@ static void dump_contents(FILE* output, const HashTable* table);
 int run_test_histogram(int argc, const char* const* argv,
                        const TestConfig* config)
 {
-    HistogramConfig params = {-1, NULL};
+    HistogramConfig params = {-1, NULL, NULL};
     FILE *output = NULL;
     HashTable table = {};
+    HashTableReducer reducer = HASH_TABLE_REDUCER_FASTMOD;
 
     int parsed = parse_args(argc, argv, &HISTOGRAM_ARGS, &params);
 
@@ -30,6 +34,9 @@ int run_test_histogram(int argc, const char* const* argv,
             params.table_size, "Table size not specified");
         ASSERT_TRUE_MESSAGE(
             params.filename != NULL, "Input file not specified");
+        ASSERT_TRUE_MESSAGE(
+            !params.reducer || parse_reducer(params.reducer, &reducer) == 0,
+            "Unknown reducer");
 
         if (config->filename)
         {
@@ -43,7 +50,15 @@ int run_test_histogram(int argc, const char* const* argv,
 
         ASSERT_ZERO_MESSAGE(
             hash_table_ctor(&table, (size_t) params.table_size),
-            "Invalid table size (not a prime number)");
+            "Invalid table size");
+        if (params.reducer)
+        {
+            ASSERT_ZERO_MESSAGE(
+                hash_table_set_reducer(&table, reducer),
+                "Reducer does not support table size");
+        }
+        /* Keep bucket count fixed to see distribution for given size */
+        hash_table_set_max_load_factor(&table, 0);
         ASSERT_ZERO_MESSAGE(
             fill_hash_table(&table, params.filename, -1),
             "Failed to read input file");
@@ -55,22 +70,37 @@ int run_test_histogram(int argc, const char* const* argv,
     }
     SAFE_BLOCK_END
     
-    dump_contents(output, &table);
+    dump_contents(output, &table, params.reducer);
     hash_table_dtor(&table);
     fclose(output);
     
     return 0;
 }
 
-static void dump_contents(FILE* output, const HashTable* table)
+static void dump_contents(FILE* output, const HashTable* table,
+                          const char* reducer)
 {
     fputs(STR(HASH_FUNCTION), output);
+    if (reducer)
+        fprintf(output, ":%s", reducer);
 
+#ifdef HASH_TABLE_SWISS
+    /* Groups play the role of buckets in open-addressing engine */
+    for (size_t i = 0; i < table->group_count; ++i)
+    {
+        size_t used = 0;
+        for (size_t j = 0; j < swiss_group_width; ++j)
+            if (!(table->control[i*swiss_group_width + j] & 0x80))
+                ++ used;
+        fprintf(output, ",%zu", used);
+    }
+#else
     for (size_t i = 0; i < table->bucket_count; ++i)
     {
-        HashTableEntry* entry = &table->buckets[i];
-        fprintf(output, ",%zu", entry->count);
+        const HashTableBucket* bucket = &table->buckets[i];
+        fprintf(output, ",%u", bucket->count);
     }
+#endif
     fputc('\n', output);
 }
 
@@ -78,6 +108,12 @@ int histogram_next_arg(const char* const* str, void* params)
 {
     HistogramConfig* config = (HistogramConfig*) params;
 
+    if (config->filename)
+    {
+        config->reducer = *str;
+        return 1;
+    }
+
     if (config->table_size >= 0)
     {
         config->filename = *str;   
@@ -97,3 +133,16 @@ int histogram_next_arg(const char* const* str, void* params)
     return 1;
 }
 
+static int parse_reducer(const char* name, HashTableReducer* reducer)
+{
+    if (strcmp(name, "fastmod") == 0)
+        *reducer = HASH_TABLE_REDUCER_FASTMOD;
+    else if (strcmp(name, "multiply-shift") == 0)
+        *reducer = HASH_TABLE_REDUCER_MULTIPLY_SHIFT;
+    else if (strcmp(name, "fibonacci") == 0)
+        *reducer = HASH_TABLE_REDUCER_FIBONACCI;
+    else
+        return -1;
+
+    return 0;
+}
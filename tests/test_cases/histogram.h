@@ -23,6 +23,7 @@ struct HistogramConfig
 {
     ssize_t table_size;
     const char* filename;
+    const char* reducer;
 };
 
 /**
@@ -49,8 +50,9 @@ int histogram_next_arg(const char* const* str, void* params);
 
 const arg_info HISTOGRAM_ARGS = {
     .help_message = 
-        "histogram <TABLE SIZE> <INPUT FILE> - Load file and calculate "
-                                                            "bucket sizes",
+        "histogram <TABLE SIZE> <INPUT FILE> [REDUCER] - Load file and "
+            "calculate bucket sizes. REDUCER is one of 'fastmod', "
+            "'multiply-shift' or 'fibonacci'",
     .name_handler = NULL,
     .plain_handler = histogram_next_arg,
     .tags = NULL,
@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "hash_table/hash_table.h"
+#include "hash_table/concurrent_table.h"
+#include "hash_table/lockfree_table.h"
+#include "table_utils/utils.h"
+#include "table_utils/parallel_fill.h"
+
+#include "test_utils/math.h"
+
+#include "scaling.h"
+
+struct LoadTime
+{
+    double mean_ms;
+    double error_ms;
+};
+
+static int measure_shared(const char* filename, size_t thread_count,
+                          size_t repeat, const HashTable* reference,
+                          LoadTime* time, int* counts_match);
+
+static int measure_lockfree(const char* filename, size_t thread_count,
+                            size_t repeat, const HashTable* reference,
+                            size_t expected_distinct,
+                            LoadTime* time, int* counts_match);
+
+static int measure_merged(const char* filename, size_t thread_count,
+                          size_t repeat, const HashTable* reference,
+                          LoadTime* time, int* counts_match);
+
+static int tables_equal(const HashTable* reference, const HashTable* table);
+
+static void print_time(FILE* output, const LoadTime* time);
+
+int run_test_scaling(int argc, const char* const* argv,
+                     const TestConfig* config)
+{
+    ScalingConfig params = {NULL, -1, -1};
+    FILE* output = NULL;
+    HashTable reference = {};
+
+    int parsed = parse_args(argc, argv, &SCALING_ARGS, &params);
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL_MESSAGE(
+            parsed, argc, "Invalid arguments");
+        ASSERT_TRUE_MESSAGE(
+            params.filename != NULL, "Input file not specified");
+
+        /* Counts of every load are checked against sequential one */
+        ASSERT_ZERO_MESSAGE(
+            hash_table_ctor(&reference, 1 << 10),
+            "Failed to create reference table");
+        ASSERT_ZERO_MESSAGE(
+            fill_hash_table(&reference, params.filename, -1),
+            "Failed to read input file");
+
+        if (config->filename)
+        {
+            ASSERT_MESSAGE(
+                output = fopen(config->filename,
+                                config->append_to_file ? "a" : "w"),
+                action_result != NULL,
+                "Failed to open output file");
+        }
+        else output = stdout;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fprintf(stderr, "Error: %s\n", assertion_info.message);
+        hash_table_dtor(&reference);
+        return 1;
+    }
+    SAFE_BLOCK_END
+
+    if (params.max_threads < 0)
+        params.max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (params.max_threads <= 0)
+        params.max_threads = 1;
+    if (params.repeat < 0)
+        params.repeat = 5;
+
+    const size_t max_threads = (size_t) params.max_threads;
+    const size_t repeat = (size_t) params.repeat;
+
+    fprintf(output, "%-8s %-24s %-24s %-24s %-24s\n",
+                    "Threads", "Merged tables (ms)", "Shared table (ms)",
+                    "Lock-free table (ms)", "Lock-free, growing (ms)");
+
+    int result = 0;
+
+    for (size_t threads = 1; threads <= max_threads;
+         threads = threads < max_threads && 2 * threads > max_threads
+                    ? max_threads
+                    : 2 * threads)
+    {
+        LoadTime merged = {}, shared = {}, lockfree = {}, growing = {};
+        int merged_match = 0, shared_match = 0;
+        int lockfree_match = 0, growing_match = 0;
+
+        SAFE_BLOCK_START
+        {
+            ASSERT_ZERO_MESSAGE(
+                measure_merged(params.filename, threads, repeat, &reference,
+                               &merged, &merged_match),
+                "Failed to load file into merged tables");
+            ASSERT_TRUE_MESSAGE(
+                merged_match, "Merged tables have wrong word counts");
+
+            ASSERT_ZERO_MESSAGE(
+                measure_shared(params.filename, threads, repeat, &reference,
+                               &shared, &shared_match),
+                "Failed to load file into shared table");
+            ASSERT_TRUE_MESSAGE(
+                shared_match, "Shared table has wrong word counts");
+
+            ASSERT_ZERO_MESSAGE(
+                measure_lockfree(params.filename, threads, repeat,
+                                 &reference, reference.distinct_count,
+                                 &lockfree, &lockfree_match),
+                "Failed to load file into lock-free table");
+            ASSERT_TRUE_MESSAGE(
+                lockfree_match, "Lock-free table has wrong word counts");
+
+            /* Table, which starts empty, grows through moved slots */
+            ASSERT_ZERO_MESSAGE(
+                measure_lockfree(params.filename, threads, repeat,
+                                 &reference, 0,
+                                 &growing, &growing_match),
+                "Failed to load file into growing lock-free table");
+            ASSERT_TRUE_MESSAGE(
+                growing_match,
+                "Growing lock-free table has wrong word counts");
+        }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            fprintf(stderr, "Error: %s\n", assertion_info.message);
+            result = 1;
+        }
+        SAFE_BLOCK_END
+
+        if (result)
+            break;
+
+        fprintf(output, "%-8zu ", threads);
+        print_time(output, &merged);
+        print_time(output, &shared);
+        print_time(output, &lockfree);
+        print_time(output, &growing);
+        fputc('\n', output);
+    }
+
+    if (output != stdout)
+        fclose(output);
+    hash_table_dtor(&reference);
+
+    return result;
+}
+
+int scaling_next_arg(const char* const* str, void* params)
+{
+    ScalingConfig* config = (ScalingConfig*) params;
+
+    if (!config->filename)
+    {
+        config->filename = *str;
+        return 1;
+    }
+
+    char* end = NULL;
+    long number = strtol(*str, &end, 10);
+
+    if (*end != '\0' || number <= 0 || config->repeat >= 0)
+    {
+        fprintf(stderr, "Error: '%s' is not a valid number\n", *str);
+        return -1;
+    }
+
+    if (config->max_threads < 0)
+        config->max_threads = number;
+    else if (number >= 2)
+        config->repeat = number;
+    else
+    {
+        /* Standard deviation needs at least two measurements */
+        fprintf(stderr, "Error: repeat count must be at least 2\n");
+        return -1;
+    }
+
+    return 1;
+}
+
+__always_inline
+static double get_time_ms(void)
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1000.0 + (double) now.tv_nsec / 1e6;
+}
+
+static void compute_load_time(const double* times, size_t repeat,
+                              LoadTime* time)
+{
+    const double mean  = get_mean(times, repeat);
+    const double error = get_stddev(times, mean, repeat);
+    const double exponent = get_round_exponent(error);
+
+    time->mean_ms  = round_with_exponent(mean,  exponent);
+    time->error_ms = round_with_exponent(error, exponent);
+}
+
+static int measure_shared(const char* filename, size_t thread_count,
+                          size_t repeat, const HashTable* reference,
+                          LoadTime* time, int* counts_match)
+{
+    double* times = (double*) calloc(repeat, sizeof(*times));
+    ConcurrentHashTable* table = (ConcurrentHashTable*) aligned_alloc(
+                                        alignof(ConcurrentHashTable),
+                                        sizeof(*table));
+    int result = 0;
+    *counts_match = 1;
+
+    for (size_t i = 0; times && table && i < repeat && !result; ++i)
+    {
+        if (concurrent_table_ctor(table, reference->distinct_count) < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        const double start = get_time_ms();
+        result = fill_concurrent_table(table, filename, -1, thread_count);
+        times[i] = get_time_ms() - start;
+
+        HashTable exported = {};
+        if (!result)
+            result = hash_table_ctor(&exported, 1 << 10);
+        if (!result)
+            result = concurrent_table_export(table, &exported);
+        if (!result && !tables_equal(reference, &exported))
+            *counts_match = 0;
+
+        hash_table_dtor(&exported);
+        concurrent_table_dtor(table);
+    }
+
+    if (!times || !table)
+        result = -1;
+    else if (!result)
+        compute_load_time(times, repeat, time);
+
+    free(times);
+    free(table);
+    return result;
+}
+
+static int measure_lockfree(const char* filename, size_t thread_count,
+                            size_t repeat, const HashTable* reference,
+                            size_t expected_distinct,
+                            LoadTime* time, int* counts_match)
+{
+    double* times = (double*) calloc(repeat, sizeof(*times));
+    int result = times ? 0 : -1;
+    *counts_match = 1;
+
+    for (size_t i = 0; i < repeat && !result; ++i)
+    {
+        LockFreeHashTable table = {};
+        if (lockfree_table_ctor(&table, expected_distinct) < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        const double start = get_time_ms();
+        result = fill_lockfree_table(&table, filename, -1, thread_count);
+        times[i] = get_time_ms() - start;
+
+        /* Export sums striped counters of hot words */
+        HashTable exported = {};
+        if (!result)
+            result = hash_table_ctor(&exported, 1 << 10);
+        if (!result)
+            result = lockfree_table_export(&table, &exported);
+        if (!result && !tables_equal(reference, &exported))
+            *counts_match = 0;
+
+        hash_table_dtor(&exported);
+        lockfree_table_dtor(&table);
+    }
+
+    if (!result)
+        compute_load_time(times, repeat, time);
+
+    free(times);
+    return result;
+}
+
+static int measure_merged(const char* filename, size_t thread_count,
+                          size_t repeat, const HashTable* reference,
+                          LoadTime* time, int* counts_match)
+{
+    double* times = (double*) calloc(repeat, sizeof(*times));
+    int result = times ? 0 : -1;
+    *counts_match = 1;
+
+    for (size_t i = 0; i < repeat && !result; ++i)
+    {
+        HashTable table = {};
+        if (hash_table_ctor(&table, 1 << 10) < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        const double start = get_time_ms();
+        result = fill_hash_table_parallel(&table, filename, -1,
+                                          thread_count);
+        times[i] = get_time_ms() - start;
+
+        if (!result && !tables_equal(reference, &table))
+            *counts_match = 0;
+        hash_table_dtor(&table);
+    }
+
+    if (!result)
+        compute_load_time(times, repeat, time);
+
+    free(times);
+    return result;
+}
+
+/**
+ * @brief Check that tables have the same total count and the same count
+ * of every word
+ *
+ * @return 1 if tables are equal, 0 otherwise
+ */
+static int tables_equal(const HashTable* reference, const HashTable* table)
+{
+    if (reference->distinct_count != table->distinct_count ||
+        reference->total_count    != table->total_count)
+        return 0;
+
+    HashTableIterator it = {};
+    if (hash_table_get_iterator(reference, &it) < 0)
+        return 1;
+
+    char key[max_word_length] __attribute__((aligned (max_word_length)));
+    do
+    {
+        /* Iterator keys are not padded, while lookups require it */
+        memset(key, 0, sizeof(key));
+        memcpy(key, it.key, strnlen(it.key, max_word_length));
+
+        if (hash_table_get_key_count(table, key) != it.count)
+            return 0;
+    } while (hash_table_iterator_get_next(&it) == 0);
+
+    return 1;
+}
+
+static void print_time(FILE* output, const LoadTime* time)
+{
+    char buffer[32] = "";
+    snprintf(buffer, sizeof(buffer), "%lg (~%lg)",
+                                     time->mean_ms, time->error_ms);
+    fprintf(output, "%-24s ", buffer);
+}
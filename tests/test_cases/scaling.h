@@ -0,0 +1,66 @@
+/**
+ * @file scaling.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ * 
+ * @brief
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TESTS_TEST_CASES_SCALING_H
+#define __TESTS_TEST_CASES_SCALING_H
+
+#include <stddef.h>
+
+#include "meerkat_args/argparser.h"
+
+#include "test_utils/config.h"
+
+
+struct ScalingConfig
+{
+    const char* filename;
+    ssize_t max_threads;
+    ssize_t repeat;
+};
+
+/**
+ * @brief Measure time of loading file by different numbers of threads
+ * into per-thread tables, which are merged afterwards, and into shared
+ * concurrent and lock-free tables. Lock-free table is loaded twice: sized
+ * for distinct words of file and starting empty. Word counts of each load
+ * are compared to sequential one
+ *
+ * @param[in] argc	    - Argument vector length
+ * @param[in] argv	    - Argument vector
+ * @param[in] config	- Test configuration
+ *
+ * @return Exit status
+ */
+int run_test_scaling(int argc, const char* const* argv,
+                     const TestConfig* config);
+
+/**
+ * @brief Load next test argument
+ *
+ * @param[in]    str    Parameter array
+ * @param[inout] params ScalingConfig instance
+ *
+ * @return 1 upon success, -1 otherwise
+ */
+int scaling_next_arg(const char* const* str, void* params);
+
+const arg_info SCALING_ARGS = {
+    .help_message = 
+        "scaling <INPUT FILE> [MAX THREADS] [REPEAT] - Load file using "
+            "1, 2, 4, ... MAX THREADS threads (number of CPUs by default) "
+            "and print loading time. REPEAT is at least 2 (5 by default)",
+    .name_handler = NULL,
+    .plain_handler = scaling_next_arg,
+    .tags = NULL,
+    .tag_cnt = 0
+};
+
+#endif /* scaling.h */
@@ -0,0 +1,343 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "table_utils/tokenizer.h"
+#include "converter.h"
+
+#include "tokenization.h"
+
+static const char default_corpus[] = "tests/data/tokenizer.txt";
+static const char data_suffix[] = ".data";
+
+/* Text is repeated up to this size, so that converter splits it into
+ * several chunks and reads each of them in several parts */
+static const size_t large_text_size = 3 << 20;
+
+static const size_t converter_thread_count = 4;
+
+static char* read_file(const char* filename, size_t* size);
+
+static int check_words(const PaddedKey* words, size_t word_count,
+                       const PaddedKey* expected, size_t expected_count);
+
+static int check_single_call(const char* text, size_t size,
+                             const PaddedKey* expected,
+                             size_t expected_count);
+
+static int check_split_calls(const char* text, size_t size,
+                             const PaddedKey* expected,
+                             size_t expected_count);
+
+static int check_converter(const char* text, size_t size,
+                           const char* data, size_t data_size,
+                           size_t repeat);
+
+int run_test_tokenization(int argc, const char* const* argv,
+                          const TestConfig* config)
+{
+    TokenizationConfig params = {};
+    FILE* output = NULL;
+    char* data_name = NULL;
+    char* text = NULL;
+    char* data = NULL;
+    size_t text_size = 0;
+    size_t data_size = 0;
+
+    int parsed = parse_args(argc, argv, &TOKENIZATION_ARGS, &params);
+    if (!params.filename)
+        params.filename = default_corpus;
+
+    const size_t name_length = strlen(params.filename);
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL_MESSAGE(
+            parsed, argc, "Invalid arguments");
+        ASSERT_MESSAGE(
+            data_name = (char*) calloc(name_length + sizeof(data_suffix),
+                                       sizeof(*data_name)),
+            action_result != NULL,
+            "Failed to allocate file name");
+
+        memcpy(data_name, params.filename, name_length);
+        memcpy(data_name + name_length, data_suffix, sizeof(data_suffix));
+
+        ASSERT_MESSAGE(
+            text = read_file(params.filename, &text_size),
+            action_result != NULL,
+            "Failed to read input file");
+        ASSERT_MESSAGE(
+            data = read_file(data_name, &data_size),
+            action_result != NULL,
+            "Failed to read converted file");
+        ASSERT_MESSAGE(
+            data_size % max_word_length,
+            action_result == 0,
+            "Converted file is not a list of padded words");
+
+        if (config->filename)
+        {
+            ASSERT_MESSAGE(
+                output = fopen(config->filename,
+                                config->append_to_file ? "a" : "w"),
+                action_result != NULL,
+                "Failed to open output file");
+        }
+        else output = stdout;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fprintf(stderr, "Error: %s\n", assertion_info.message);
+        free(data_name);
+        free(text);
+        free(data);
+        return 1;
+    }
+    SAFE_BLOCK_END
+
+    const PaddedKey* expected = (const PaddedKey*) data;
+    const size_t expected_count = data_size / max_word_length;
+
+    const int single_result = check_single_call(text, text_size,
+                                                expected, expected_count);
+    const int split_result  = check_split_calls(text, text_size,
+                                                expected, expected_count);
+    const int convert_result = check_converter(text, text_size,
+                                               data, data_size, 1);
+    const int large_result   = check_converter(text, text_size,
+                                               data, data_size,
+                                    large_text_size / (text_size + 1) + 1);
+
+    fprintf(output, "%-24s %s\n", "Single call",
+                    single_result  ? "FAILED" : "OK");
+    fprintf(output, "%-24s %s\n", "Split at every byte",
+                    split_result   ? "FAILED" : "OK");
+    fprintf(output, "%-24s %s\n", "Converter",
+                    convert_result ? "FAILED" : "OK");
+    fprintf(output, "%-24s %s\n", "Converter, large text",
+                    large_result   ? "FAILED" : "OK");
+
+    if (output != stdout)
+        fclose(output);
+    free(data_name);
+    free(text);
+    free(data);
+
+    return single_result || split_result || convert_result || large_result;
+}
+
+int tokenization_next_arg(const char* const* str, void* params)
+{
+    TokenizationConfig* config = (TokenizationConfig*) params;
+
+    if (config->filename)
+    {
+        fprintf(stderr, "Error: unexpected argument '%s'\n", *str);
+        return -1;
+    }
+
+    config->filename = *str;
+    return 1;
+}
+
+/**
+ * @brief Read whole file into buffer, aligned to `max_word_length` and
+ * padded with zeros to a multiple of it
+ *
+ * @return Allocated buffer, NULL upon error
+ */
+static char* read_file(const char* filename, size_t* size)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return NULL;
+
+    char* buffer = NULL;
+    long length = -1;
+
+    if (fseek(file, 0, SEEK_END) == 0)
+        length = ftell(file);
+
+    if (length >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        const size_t capacity = ((size_t) length / max_word_length + 1)
+                              * max_word_length;
+        buffer = (char*) aligned_alloc(max_word_length, capacity);
+        if (buffer)
+            memset(buffer, 0, capacity);
+    }
+
+    if (buffer && fread(buffer, 1, (size_t) length, file) != (size_t) length)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    fclose(file);
+
+    *size = (size_t) length;
+    return buffer;
+}
+
+/**
+ * @brief Check that extracted words are the expected ones
+ *
+ * @return 0 if words are equal, -1 otherwise
+ */
+static int check_words(const PaddedKey* words, size_t word_count,
+                       const PaddedKey* expected, size_t expected_count)
+{
+    if (word_count != expected_count)
+        return -1;
+
+    for (size_t i = 0; i < word_count; ++i)
+        if (memcmp(words[i].data, expected[i].data, max_word_length) != 0)
+            return -1;
+
+    return 0;
+}
+
+/**
+ * @brief Tokenize whole text in one call
+ *
+ * @return 0 if expected words are extracted, -1 otherwise
+ */
+static int check_single_call(const char* text, size_t size,
+                             const PaddedKey* expected,
+                             size_t expected_count)
+{
+    /* One more word is allowed, so that extra words are noticed */
+    const size_t max_words = expected_count + 1;
+    PaddedKey* words = (PaddedKey*) aligned_alloc(alignof(PaddedKey),
+                                                  max_words * sizeof(*words));
+    if (!words)
+        return -1;
+
+    size_t word_count = 0;
+    const size_t processed = tokenize_text(text, size, 1,
+                                           words, max_words, &word_count);
+
+    int result = processed == size ? 0 : -1;
+    if (!result)
+        result = check_words(words, word_count, expected, expected_count);
+
+    free(words);
+    return result;
+}
+
+/**
+ * @brief Split text in two parts at every byte and tokenize them in two
+ * calls, as if the parts were read one after another. Bytes, which are
+ * left unprocessed by the first call, are passed to the second one
+ *
+ * @return 0 if expected words are extracted for every split, -1 otherwise
+ */
+static int check_split_calls(const char* text, size_t size,
+                             const PaddedKey* expected,
+                             size_t expected_count)
+{
+    const size_t max_words = expected_count + 1;
+    PaddedKey* words = (PaddedKey*) aligned_alloc(alignof(PaddedKey),
+                                                  max_words * sizeof(*words));
+    if (!words)
+        return -1;
+
+    int result = 0;
+
+    for (size_t split = 0; split <= size && !result; ++split)
+    {
+        size_t first_count = 0;
+        size_t second_count = 0;
+
+        const size_t first = tokenize_text(text, split, 0,
+                                           words, max_words, &first_count);
+        const size_t second = tokenize_text(text + first, size - first, 1,
+                                            words + first_count,
+                                            max_words - first_count,
+                                            &second_count);
+
+        if (first > split || first + second != size)
+            result = -1;
+        else
+            result = check_words(words, first_count + second_count,
+                                 expected, expected_count);
+
+        if (result)
+            fprintf(stderr, "Words differ, when text is split at byte %zu\n",
+                            split);
+    }
+
+    free(words);
+    return result;
+}
+
+/**
+ * @brief Write text, repeated several times, into temporary file and
+ * convert it by `convert_text_file()`. Every copy of text is followed by
+ * newline, so that words of adjacent copies are not joined
+ *
+ * @return 0 if output is converted file, repeated the same number of
+ * times, -1 otherwise
+ */
+static int check_converter(const char* text, size_t size,
+                           const char* data, size_t data_size,
+                           size_t repeat)
+{
+    char input_name[]  = "/tmp/tokenization-XXXXXX";
+    char output_name[] = "/tmp/tokenization-XXXXXX";
+    char* converted = NULL;
+    size_t converted_size = 0;
+    FILE* input = NULL;
+    int output = -1;
+    int result = 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_NON_NEGATIVE(
+            output = mkstemp(output_name));
+        ASSERT_NON_NEGATIVE(
+            close(output));
+        ASSERT_NON_NEGATIVE(
+            output = mkstemp(input_name));
+        ASSERT_TRUE(
+            input = fdopen(output, "wb"));
+
+        for (size_t i = 0; i < repeat; ++i)
+        {
+            ASSERT_EQUAL(
+                fwrite(text, 1, size, input), size);
+            ASSERT_NON_NEGATIVE(
+                fputc('\n', input));
+        }
+
+        ASSERT_ZERO(
+            fclose(input));
+        ASSERT_ZERO(
+            convert_text_file(input_name, output_name,
+                              converter_thread_count));
+        ASSERT_TRUE(
+            converted = read_file(output_name, &converted_size));
+        ASSERT_EQUAL(
+            converted_size, data_size * repeat);
+
+        for (size_t i = 0; i < repeat; ++i)
+            ASSERT_ZERO(
+                memcmp(converted + i * data_size, data, data_size));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        fprintf(stderr, "Converted text differs from expected one\n");
+        result = -1;
+    }
+    SAFE_BLOCK_END
+
+    unlink(input_name);
+    unlink(output_name);
+    free(converted);
+
+    return result;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file tokenization.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TESTS_TEST_CASES_TOKENIZATION_H
+#define __TESTS_TEST_CASES_TOKENIZATION_H
+
+#include <stddef.h>
+
+#include "meerkat_args/argparser.h"
+
+#include "test_utils/config.h"
+
+struct TokenizationConfig
+{
+    const char* filename;
+};
+
+/**
+ * @brief Extract words from raw text and compare them to words of
+ * `.data` file, produced from it by `convert.py`. Text is tokenized at
+ * once and split in two parts at every byte, with unprocessed bytes of the
+ * first part carried over to the second one. Text is then converted by
+ * native converter as is and repeated to several megabytes, so that it is
+ * split into several chunks
+ *
+ * @param[in] argc	    - Argument vector length
+ * @param[in] argv	    - Argument vector
+ * @param[in] config	- Test configuration
+ *
+ * @return Exit status
+ */
+int run_test_tokenization(int argc, const char* const* argv,
+                          const TestConfig* config);
+
+/**
+ * @brief Load next test argument
+ *
+ * @param[in]    str    Parameter array
+ * @param[inout] params TokenizationConfig instance
+ *
+ * @return 1 upon success, -1 otherwise
+ */
+int tokenization_next_arg(const char* const* str, void* params);
+
+const arg_info TOKENIZATION_ARGS = {
+    .help_message =
+        "tokenization [INPUT FILE] - Tokenize INPUT FILE "
+            "(tests/data/tokenizer.txt by default) and compare words to "
+            "INPUT FILE.data, produced by convert.py",
+    .name_handler = NULL,
+    .plain_handler = tokenization_next_arg,
+    .tags = NULL,
+    .tag_cnt = 0
+};
+
+#endif /* tokenization.h */
@@ -39,6 +39,24 @@ int test_select_test_case(const char* const* str, void* params)
         return 1;
     }
 
+    if (strcasecmp(test_name, "scaling") == 0)
+    {
+        config->test_case = TEST_SCALING;
+        return 1;
+    }
+
+    if (strcasecmp(test_name, "growth") == 0)
+    {
+        config->test_case = TEST_GROWTH;
+        return 1;
+    }
+
+    if (strcasecmp(test_name, "tokenization") == 0)
+    {
+        config->test_case = TEST_TOKENIZATION;
+        return 1;
+    }
+
     fprintf(stderr, "Error: unknown test case '%s'\n", test_name);
     config->had_error = 1;
     return -1;
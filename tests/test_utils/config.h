@@ -21,6 +21,9 @@ enum TestCase
     TEST_NONE,
     TEST_BENCHMARK_FULL,
     TEST_HISTOGRAM,
+    TEST_SCALING,
+    TEST_GROWTH,
+    TEST_TOKENIZATION,
 };
 
 struct TestConfig
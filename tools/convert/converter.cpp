@@ -0,0 +1,707 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "table_utils/tokenizer.h"
+
+#include "converter.h"
+
+/* Size of buffer for text of one chunk */
+static const size_t chunk_buffer_size = 1 << 20;
+
+/* Number of words in one block of tokenized output */
+static const size_t block_word_count = 1024;
+
+/* Chunks smaller than this are not worth a separate thread */
+static const off_t min_chunk_size = 1 << 20;
+
+/* Chunks keep at most this share of physical memory for their words,
+ * and spill the rest to temporary files */
+static const size_t memory_budget_divisor = 4;
+
+/* Size of buffer for copying spilled words, if kernel cannot copy them */
+static const size_t copy_buffer_size = 1 << 20;
+
+/**
+ * @brief Part of input, processed by one thread.
+ *
+ * Input is tokenized once. Offset of the first chunk in output is known
+ * beforehand, so it writes its words directly. Other chunks keep words in
+ * `blocks` until their offset is computed from word counts of preceding
+ * chunks, and spill words, which do not fit into `max_blocks`, to temporary
+ * file `spill`
+ */
+struct ConvertChunk
+{
+    int input;
+    int output;
+
+    off_t begin;
+    off_t end;
+
+    int write_direct;
+    const char* spill_dir;
+
+    PaddedKey** blocks;
+    size_t block_count;
+    size_t block_array_size;
+    size_t max_blocks;
+    size_t last_block_fill;
+
+    int spill;
+    off_t spill_size;
+
+    size_t word_count;
+    off_t  output_offset;
+
+    int error;
+};
+
+static off_t find_chunk_boundary(int input, off_t position, off_t size);
+static int run_chunks(ConvertChunk* chunks, size_t chunk_count,
+                      void* (*routine)(void*));
+static void* tokenize_chunk(void* chunk_ptr);
+static void* write_chunk(void* chunk_ptr);
+static void destroy_chunk(ConvertChunk* chunk);
+static char* get_directory(const char* path);
+static int write_all(int output, const char* data, size_t size, off_t offset);
+
+int convert_text_file(const char* input_name, const char* output_name,
+                      size_t thread_count)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(input_name  != NULL);
+        ASSERT_TRUE(output_name != NULL);
+        ASSERT_POSITIVE(thread_count);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    int input = -1;
+    int output = -1;
+    struct stat input_stat = {};
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_NON_NEGATIVE(
+                input = open(input_name, O_RDONLY));
+        ASSERT_ZERO(
+                fstat(input, &input_stat));
+        ASSERT_NON_NEGATIVE(
+                output = open(output_name, O_WRONLY | O_CREAT | O_TRUNC,
+                              0666));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        if (input  >= 0) close(input);
+        errno = EACCES;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const off_t size = input_stat.st_size;
+
+    size_t chunk_count = thread_count;
+    if ((off_t) chunk_count > size / min_chunk_size)
+        chunk_count = size / min_chunk_size > 0
+                        ? (size_t) (size / min_chunk_size)
+                        : 1;
+
+    ConvertChunk* chunks = (ConvertChunk*) calloc(chunk_count,
+                                                  sizeof(*chunks));
+    char* spill_dir = get_directory(output_name);
+    if (!chunks || !spill_dir)
+    {
+        // TODO: Logs
+        free(chunks);
+        free(spill_dir);
+        close(input);
+        close(output);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    const size_t memory_size = (size_t) sysconf(_SC_PHYS_PAGES)
+                             * (size_t) sysconf(_SC_PAGESIZE);
+    const size_t max_blocks = memory_size / memory_budget_divisor
+                            / (block_word_count * sizeof(PaddedKey))
+                            / chunk_count;
+
+    off_t begin = 0;
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        const off_t nominal_end = size / (off_t) chunk_count * (off_t) (i + 1);
+        const off_t end = i + 1 < chunk_count
+                            ? find_chunk_boundary(input, nominal_end, size)
+                            : size;
+
+        chunks[i].input  = input;
+        chunks[i].output = output;
+        chunks[i].begin  = begin;
+        chunks[i].end    = end > begin ? end : begin;
+        chunks[i].write_direct = i == 0;
+        chunks[i].spill_dir = spill_dir;
+        chunks[i].max_blocks = max_blocks;
+        chunks[i].spill = -1;
+
+        begin = chunks[i].end;
+    }
+
+    int result = run_chunks(chunks, chunk_count, tokenize_chunk);
+
+    if (result == 0)
+    {
+        off_t offset = 0;
+        for (size_t i = 0; i < chunk_count; ++i)
+        {
+            chunks[i].output_offset = offset;
+            offset += (off_t) (chunks[i].word_count * max_word_length);
+        }
+
+        /* Chunks write disjoint parts of output, so its final size is set
+         * before any of them is written */
+        if (ftruncate(output, offset) < 0)
+        {
+            // TODO: Logs
+            errno = EACCES;
+            result = -1;
+        }
+    }
+
+    if (result == 0)
+        result = run_chunks(chunks, chunk_count, write_chunk);
+
+    for (size_t i = 0; i < chunk_count; ++i)
+        destroy_chunk(&chunks[i]);
+
+    free(chunks);
+    free(spill_dir);
+    close(input);
+    if (close(output) < 0 && result == 0)
+    {
+        // TODO: Logs
+        errno = EACCES;
+        result = -1;
+    }
+
+    return result;
+}
+
+__always_inline
+static int is_ascii_space(char c)
+{
+    return (c >= '\t' && c <= '\r') || (c >= 0x1C && c <= ' ');
+}
+
+/**
+ * @brief Find first position after ASCII whitespace, starting from given
+ * one. Multibyte characters never contain ASCII bytes, so splitting text
+ * there does not split any word or character
+ *
+ * @return Found position, `size` if there is no whitespace
+ */
+static off_t find_chunk_boundary(int input, off_t position, off_t size)
+{
+    const size_t window_size = 4096;
+    char window[window_size] = {};
+
+    while (position < size)
+    {
+        const ssize_t read_result = pread(input, window, window_size,
+                                          position);
+        if (read_result <= 0)
+            return size;
+
+        for (ssize_t i = 0; i < read_result; ++i)
+            if (is_ascii_space(window[i]))
+                return position + i + 1;
+
+        position += read_result;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Run routine for every chunk in its own thread and wait for all
+ * of them
+ */
+static int run_chunks(ConvertChunk* chunks, size_t chunk_count,
+                      void* (*routine)(void*))
+{
+    pthread_t* threads = (pthread_t*) calloc(chunk_count, sizeof(*threads));
+    if (!threads)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t started = 0;
+    for (; started < chunk_count; ++started)
+        if (pthread_create(&threads[started], NULL,
+                           routine, &chunks[started]) != 0)
+            break;
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+
+    if (started < chunk_count)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        if (chunks[i].error)
+        {
+            // TODO: Logs
+            errno = chunks[i].error;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Open unnamed temporary file for spilled words. It is created
+ * near output, so that its contents can be copied without leaving the
+ * file system
+ *
+ * @return File descriptor, -1 upon error
+ */
+static int open_spill_file(const char* directory)
+{
+    int spill = open(directory, O_TMPFILE | O_RDWR, 0600);
+    if (spill >= 0)
+        return spill;
+
+    FILE* file = tmpfile();
+    if (!file)
+        return -1;
+
+    spill = dup(fileno(file));
+    fclose(file);
+
+    return spill;
+}
+
+/**
+ * @brief Keep block in chunk, so that it is written after offset of chunk
+ * is known
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int keep_block(ConvertChunk* chunk, PaddedKey* block)
+{
+    if (chunk->block_count == chunk->block_array_size)
+    {
+        const size_t new_size = chunk->block_array_size
+                                ? 2 * chunk->block_array_size
+                                : 16;
+        PaddedKey** blocks = (PaddedKey**) realloc(
+                                    chunk->blocks,
+                                    new_size * sizeof(*blocks));
+        if (!blocks)
+            return -1;
+
+        chunk->blocks = blocks;
+        chunk->block_array_size = new_size;
+    }
+
+    chunk->blocks[chunk->block_count++] = block;
+    return 0;
+}
+
+/**
+ * @brief Write first `words` words of block to spill file, opening it if
+ * needed
+ *
+ * @return 0 upon success, -1 upon error
+ */
+static int spill_block(ConvertChunk* chunk, const PaddedKey* block,
+                       size_t words)
+{
+    if (chunk->spill < 0 &&
+        (chunk->spill = open_spill_file(chunk->spill_dir)) < 0)
+        return -1;
+
+    if (write_all(chunk->spill, (const char*) block, words * sizeof(*block),
+                  chunk->spill_size) < 0)
+        return -1;
+
+    chunk->spill_size += (off_t) (words * sizeof(*block));
+    return 0;
+}
+
+/**
+ * @brief Store `words` words of block, which is being filled. Words of
+ * chunk with known offset are written to output. Otherwise, block is kept
+ * in memory, while it fits into memory budget, and is spilled after that.
+ * Spilled words always follow ones in memory
+ *
+ * @return Block for next words, NULL upon error
+ */
+static PaddedKey* store_block(ConvertChunk* chunk, PaddedKey* block,
+                              size_t words)
+{
+    if (chunk->write_direct)
+    {
+        if (write_all(chunk->output, (const char*) block,
+                      words * sizeof(*block),
+                      (off_t) ((chunk->word_count - words)
+                               * max_word_length)) < 0)
+        {
+            errno = EACCES;
+            return NULL;
+        }
+
+        return block;
+    }
+
+    if (chunk->spill_size == 0 && chunk->block_count < chunk->max_blocks)
+    {
+        /* Block stays with caller, unless it is kept */
+        PaddedKey* next = (PaddedKey*) aligned_alloc(max_word_length,
+                                                     block_word_count
+                                                     * sizeof(*next));
+        if (!next || keep_block(chunk, block) < 0)
+        {
+            free(next);
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        return next;
+    }
+
+    if (spill_block(chunk, block, words) < 0)
+    {
+        errno = EACCES;
+        return NULL;
+    }
+
+    return block;
+}
+
+/**
+ * @brief Tokenize chunk of input. Words are written to output, if its
+ * offset is known, and stored in chunk otherwise
+ */
+static void* tokenize_chunk(void* chunk_ptr)
+{
+    ConvertChunk* chunk = (ConvertChunk*) chunk_ptr;
+
+    char* text = (char*) malloc(chunk_buffer_size);
+    PaddedKey* block = (PaddedKey*) aligned_alloc(
+                                        max_word_length,
+                                        block_word_count * sizeof(*block));
+    if (!text || !block)
+    {
+        // TODO: Logs
+        free(text);
+        free(block);
+        chunk->error = ENOMEM;
+        return NULL;
+    }
+    size_t fill = 0;
+
+    off_t position = chunk->begin;
+    size_t filled = 0;
+    int at_end = position >= chunk->end;
+
+    while (!chunk->error)
+    {
+        if (!at_end)
+        {
+            size_t to_read = chunk_buffer_size - filled;
+            if ((off_t) to_read > chunk->end - position)
+                to_read = (size_t) (chunk->end - position);
+
+            const ssize_t read_result = pread(chunk->input, text + filled,
+                                              to_read, position);
+            if (read_result < 0)
+            {
+                // TODO: Logs
+                chunk->error = EACCES;
+                break;
+            }
+
+            filled += (size_t) read_result;
+            position += read_result;
+            at_end = read_result == 0 || position >= chunk->end;
+        }
+
+        size_t processed = 0;
+        size_t extracted = 0;
+        size_t space = 0;
+        do
+        {
+            if (fill == block_word_count)
+            {
+                PaddedKey* next = store_block(chunk, block, fill);
+                if (!next)
+                {
+                    // TODO: Logs
+                    chunk->error = errno;
+                    break;
+                }
+
+                /* Stored block is owned by chunk, if it was not reused */
+                block = next;
+                fill = 0;
+            }
+            space = block_word_count - fill;
+
+            processed += tokenize_text(text + processed, filled - processed,
+                                       at_end, block + fill, space,
+                                       &extracted);
+
+            /* Buffer filled with one unfinished word is processed as is */
+            if (!processed && !extracted && filled == chunk_buffer_size)
+                processed = tokenize_text(text, filled, 1, block + fill,
+                                          space, &extracted);
+
+            fill += extracted;
+            chunk->word_count += extracted;
+        } while (extracted == space);
+
+        memmove(text, text + processed, filled - processed);
+        filled -= processed;
+
+        if (at_end)
+            break;
+    }
+
+    free(text);
+
+    chunk->last_block_fill = block_word_count;
+
+    if (!chunk->error && fill)
+    {
+        if (!chunk->write_direct && chunk->spill_size == 0)
+        {
+            /* The last kept block may be filled partially */
+            if (keep_block(chunk, block) < 0)
+                chunk->error = ENOMEM;
+            else
+            {
+                chunk->last_block_fill = fill;
+                block = NULL;
+            }
+        }
+        else if (!store_block(chunk, block, fill))
+            chunk->error = errno;
+    }
+
+    free(block);
+    return NULL;
+}
+
+/**
+ * @brief Write whole vector of buffers at given offset, continuing after
+ * partial writes
+ */
+static int write_vector(int output, iovec* buffers, size_t buffer_count,
+                        off_t offset)
+{
+    while (buffer_count)
+    {
+        const int count = buffer_count < IOV_MAX ? (int) buffer_count
+                                                 : IOV_MAX;
+        ssize_t written = pwritev(output, buffers, count, offset);
+        if (written <= 0)
+            return -1;
+
+        offset += written;
+        while (buffer_count && (size_t) written >= buffers->iov_len)
+        {
+            written -= (ssize_t) buffers->iov_len;
+            ++ buffers;
+            -- buffer_count;
+        }
+
+        if (buffer_count)
+        {
+            buffers->iov_base = (char*) buffers->iov_base + written;
+            buffers->iov_len -= (size_t) written;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Copy spilled words of chunk to output, using kernel copy if it is
+ * supported
+ */
+static int copy_spill(const ConvertChunk* chunk, off_t offset)
+{
+    off_t source = 0;
+
+    while (source < chunk->spill_size)
+    {
+        const ssize_t copied = copy_file_range(
+                                    chunk->spill, &source,
+                                    chunk->output, &offset,
+                                    (size_t) (chunk->spill_size - source),
+                                    0);
+        if (copied > 0)
+            continue;
+        if (copied == 0)
+            return -1;
+
+        if (errno != EXDEV && errno != EINVAL && errno != ENOSYS &&
+            errno != EOPNOTSUPP)
+            return -1;
+
+        break;
+    }
+
+    if (source == chunk->spill_size)
+        return 0;
+
+    char* buffer = (char*) malloc(copy_buffer_size);
+    if (!buffer)
+        return -1;
+
+    int result = 0;
+    while (source < chunk->spill_size && result == 0)
+    {
+        const ssize_t read_result = pread(chunk->spill, buffer,
+                                          copy_buffer_size, source);
+        if (read_result <= 0 ||
+            write_all(chunk->output, buffer, (size_t) read_result,
+                      offset) < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        source += read_result;
+        offset += read_result;
+    }
+
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief Write words, stored in chunk, to output at offset of chunk
+ */
+static void* write_chunk(void* chunk_ptr)
+{
+    ConvertChunk* chunk = (ConvertChunk*) chunk_ptr;
+
+    if (chunk->write_direct || (!chunk->block_count && !chunk->spill_size))
+        return NULL;
+
+    iovec* buffers = (iovec*) calloc(chunk->block_count + 1,
+                                     sizeof(*buffers));
+    if (!buffers)
+    {
+        // TODO: Logs
+        chunk->error = ENOMEM;
+        return NULL;
+    }
+
+    size_t stored_size = 0;
+    for (size_t i = 0; i < chunk->block_count; ++i)
+    {
+        const size_t words = i + 1 < chunk->block_count
+                           ? block_word_count
+                           : chunk->last_block_fill;
+
+        buffers[i].iov_base = chunk->blocks[i];
+        buffers[i].iov_len  = words * sizeof(PaddedKey);
+        stored_size += buffers[i].iov_len;
+    }
+
+    if (write_vector(chunk->output, buffers, chunk->block_count,
+                     chunk->output_offset) < 0 ||
+        (chunk->spill_size &&
+         copy_spill(chunk, chunk->output_offset + (off_t) stored_size) < 0))
+    {
+        // TODO: Logs
+        chunk->error = EACCES;
+    }
+
+    free(buffers);
+    return NULL;
+}
+
+/**
+ * @brief Free words, stored in chunk, and close its spill file
+ */
+static void destroy_chunk(ConvertChunk* chunk)
+{
+    for (size_t i = 0; i < chunk->block_count; ++i)
+        free(chunk->blocks[i]);
+    free(chunk->blocks);
+
+    if (chunk->spill >= 0)
+        close(chunk->spill);
+
+    chunk->blocks = NULL;
+    chunk->block_count = 0;
+    chunk->spill = -1;
+}
+
+/**
+ * @brief Get directory part of path
+ *
+ * @return Allocated directory path, NULL upon error
+ */
+static char* get_directory(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    if (!slash)
+        return strdup(".");
+
+    if (slash == path)
+        return strdup("/");
+
+    return strndup(path, (size_t) (slash - path));
+}
+
+/**
+ * @brief Write whole buffer at given offset, continuing after partial
+ * writes
+ */
+static int write_all(int output, const char* data, size_t size, off_t offset)
+{
+    while (size)
+    {
+        const ssize_t written = pwrite(output, data, size, offset);
+        if (written <= 0)
+            return -1;
+
+        data   += written;
+        size   -= (size_t) written;
+        offset += written;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file converter.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Parallel conversion of raw text files to lists of padded words
+ *
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TOOLS_CONVERT_CONVERTER_H
+#define __TOOLS_CONVERT_CONVERTER_H
+
+#include <stddef.h>
+
+/**
+ * @brief Write words of text file to output file in format, produced by
+ * `convert.py`: each word is padded with zeros to `max_word_length` bytes.
+ *
+ * Input is split into chunks at whitespace, and chunks are processed in
+ * parallel. Input is read and tokenized once: the first chunk writes its
+ * words directly, while other chunks keep them in memory, spilling them to
+ * temporary file above memory budget, and write them at their final offset
+ * in output, once word counts of preceding chunks are known
+ *
+ * @param[in] input_name    - Path to text file
+ * @param[in] output_name   - Path to output file
+ * @param[in] thread_count  - Number of threads processing chunks
+ *
+ * @return 0 upon success, -1 upon error
+ *
+ * @exception EINVAL    - file name is NULL or thread count is 0
+ * @exception EACCES    - failed to open, read or write file
+ * @exception ENOMEM    - failed to allocate buffers or start threads
+ */
+int convert_text_file(const char* input_name, const char* output_name,
+                      size_t thread_count);
+
+#endif /* converter.h */
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "converter.h"
+
+static const char data_suffix[] = ".data";
+
+int main(int argc, char** argv)
+{
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* input_name = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            char* end = NULL;
+            thread_count = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || thread_count <= 0)
+            {
+                printf("Invalid thread count '%s'\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+
+        if (input_name)
+        {
+            puts("Too many arguments");
+            return 1;
+        }
+        input_name = argv[i];
+    }
+
+    if (!input_name)
+    {
+        puts("No input file provided");
+        return 1;
+    }
+
+    if (access(input_name, F_OK) != 0)
+    {
+        printf("File '%s' not found\n", input_name);
+        return 1;
+    }
+
+    if (thread_count <= 0)
+        thread_count = 1;
+
+    const size_t name_length = strlen(input_name);
+    char* output_name = (char*) calloc(name_length + sizeof(data_suffix),
+                                       sizeof(*output_name));
+    if (!output_name)
+    {
+        perror("Failed to convert file");
+        return 1;
+    }
+    memcpy(output_name, input_name, name_length);
+    memcpy(output_name + name_length, data_suffix, sizeof(data_suffix));
+
+    const int result = convert_text_file(input_name, output_name,
+                                         (size_t) thread_count);
+    if (result < 0)
+        perror("Failed to convert file");
+
+    free(output_name);
+    return result < 0 ? 1 : 0;
+}